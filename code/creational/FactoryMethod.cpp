@@ -1,4 +1,109 @@
 #include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+static bool quietDrawing = false; // the benchmark draws without printing
+static unsigned long drawCalls = 0;
+
+// A contiguous block of `count` products of one concrete type, made with a
+// single allocation and seen as Base. It owns the objects: they are destroyed
+// and the block freed together when the range goes away. Iteration walks the
+// block in memory order, so a pass over all products stays cache friendly
+// and its virtual calls all resolve to the same target.
+template <typename Base>
+class ProductRange
+{
+private:
+    void *block = nullptr;
+    void (*destroy)(void *) = nullptr;
+    Base *first = nullptr;
+    std::size_t stride = 0; // bytes between consecutive products
+    std::size_t count = 0;
+
+    Base *at(std::size_t i) const
+    {
+        return reinterpret_cast<Base *>(reinterpret_cast<char *>(first) + i * stride);
+    }
+
+public:
+    class iterator
+    {
+    private:
+        char *at;
+        std::size_t stride;
+
+    public:
+        iterator(Base *at, std::size_t stride) : at(reinterpret_cast<char *>(at)), stride(stride) {}
+        Base &operator*() const { return *reinterpret_cast<Base *>(at); }
+        Base *operator->() const { return reinterpret_cast<Base *>(at); }
+        iterator &operator++()
+        {
+            at += stride;
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return at == other.at; }
+        bool operator!=(const iterator &other) const { return at != other.at; }
+    };
+
+    ProductRange() = default;
+
+    // `n` default-constructed Products in one block.
+    template <typename Product>
+    static ProductRange Of(std::size_t n)
+    {
+        ProductRange range;
+        if (n == 0)
+        {
+            return range;
+        }
+        Product *products = new Product[n];
+        range.block = products;
+        range.destroy = [](void *block)
+        { delete[] static_cast<Product *>(block); };
+        range.first = products; // Base subobject of the first product
+        range.stride = sizeof(Product);
+        range.count = n;
+        return range;
+    }
+
+    ProductRange(ProductRange &&other) noexcept { *this = std::move(other); }
+    ProductRange &operator=(ProductRange &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            std::swap(block, other.block);
+            std::swap(destroy, other.destroy);
+            std::swap(first, other.first);
+            std::swap(stride, other.stride);
+            std::swap(count, other.count);
+        }
+        return *this;
+    }
+    ProductRange(const ProductRange &) = delete;
+    ProductRange &operator=(const ProductRange &) = delete;
+    ~ProductRange() { reset(); }
+
+    void reset()
+    {
+        if (block)
+        {
+            destroy(block);
+        }
+        block = nullptr;
+        first = nullptr;
+        count = 0;
+    }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    Base &operator[](std::size_t i) const { return *at(i); }
+    iterator begin() const { return iterator(first, stride); }
+    iterator end() const { return iterator(at(count), stride); }
+};
 
 // Abstract product class
 class Shape
@@ -14,7 +119,9 @@ class Circle : public Shape
 public:
     void draw() override
     {
-        std::cout << "Drawing a Circle" << std::endl;
+        drawCalls++;
+        if (!quietDrawing)
+            std::cout << "Drawing a Circle" << std::endl;
     }
 };
 
@@ -24,7 +131,9 @@ class Square : public Shape
 public:
     void draw() override
     {
-        std::cout << "Drawing a Square" << std::endl;
+        drawCalls++;
+        if (!quietDrawing)
+            std::cout << "Drawing a Square" << std::endl;
     }
 };
 
@@ -33,6 +142,7 @@ class ShapeFactory
 {
 public:
     virtual Shape *createShape() = 0;
+    virtual ProductRange<Shape> createMany(std::size_t n) = 0; // n shapes in one allocation
     virtual ~ShapeFactory() {} // Virtual destructor for polymorphism
 };
 // Concrete creator class - CircleFactory
@@ -43,6 +153,10 @@ public:
     {
         return new Circle();
     }
+    ProductRange<Shape> createMany(std::size_t n) override
+    {
+        return ProductRange<Shape>::Of<Circle>(n);
+    }
 };
 
 // Concrete creator class - SquareFactory
@@ -53,6 +167,10 @@ public:
     {
         return new Square();
     }
+    ProductRange<Shape> createMany(std::size_t n) override
+    {
+        return ProductRange<Shape>::Of<Square>(n);
+    }
 };
 
 class IOutput
@@ -94,6 +212,7 @@ class DeviceFactory
 {
 public:
     virtual IOutput *CreateDevice() = 0;
+    virtual ProductRange<IOutput> createMany(std::size_t n) = 0; // n devices in one allocation
     virtual ~DeviceFactory() {};
 };
 
@@ -104,6 +223,10 @@ public:
     {
         return new LED();
     }
+    ProductRange<IOutput> createMany(std::size_t n) override
+    {
+        return ProductRange<IOutput>::Of<LED>(n);
+    }
 };
 class Buzzer_Factory : public DeviceFactory
 {
@@ -112,10 +235,80 @@ public:
     {
         return new Buzzer();
     }
+    ProductRange<IOutput> createMany(std::size_t n) override
+    {
+        return ProductRange<IOutput>::Of<Buzzer>(n);
+    }
 };
 
+// Creates, draws and destroys `n` shapes of each factory, one `new` per
+// shape against one createMany block per factory.
+static void RunBenchmark(std::size_t n)
+{
+    CircleFactory circles;
+    SquareFactory squares;
+    ShapeFactory *factories[] = {&circles, &squares};
+    quietDrawing = true;
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration elapsed)
+    { return std::chrono::duration<double, std::milli>(elapsed).count(); };
+
+    for (int bulk = 0; bulk < 2; bulk++)
+    {
+        drawCalls = 0;
+        auto start = Clock::now();
+        std::vector<Shape *> single;
+        std::vector<ProductRange<Shape>> blocks;
+        for (ShapeFactory *factory : factories)
+        {
+            if (bulk)
+            {
+                blocks.push_back(factory->createMany(n));
+            }
+            else
+            {
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    single.push_back(factory->createShape());
+                }
+            }
+        }
+        auto created = Clock::now();
+        for (int pass = 0; pass < 5; pass++)
+        {
+            for (Shape *shape : single)
+            {
+                shape->draw();
+            }
+            for (const ProductRange<Shape> &block : blocks)
+            {
+                for (Shape &shape : block)
+                {
+                    shape.draw();
+                }
+            }
+        }
+        auto drawn = Clock::now();
+        for (Shape *shape : single)
+        {
+            delete shape;
+        }
+        blocks.clear();
+        auto destroyed = Clock::now();
+        std::cout << (bulk ? "createMany   " : "createShape  ") << "create " << ms(created - start) << " ms, draw x5 "
+                  << ms(drawn - created) << " ms, destroy " << ms(destroyed - drawn) << " ms (" << drawCalls
+                  << " draws)" << std::endl;
+    }
+    quietDrawing = false;
+}
+
 int main(int argc, const char **argv)
 {
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+    {
+        RunBenchmark(argc > 2 ? std::stoul(argv[2]) : 5000000);
+        return 0;
+    }
 
     ShapeFactory *circleFactory = new CircleFactory();
     ShapeFactory *squareFactory = new SquareFactory();
@@ -138,6 +331,14 @@ int main(int argc, const char **argv)
     led1->TurnOff();
     buzzer1->TurnOff();
 
+    ProductRange<Shape> squares = squareFactory->createMany(3);
+    for (Shape &shape : squares)
+    {
+        shape.draw();
+    }
+    ProductRange<IOutput> leds = led_factory->createMany(2);
+    leds[1].TurnOn();
+
     delete circleFactory;
     delete squareFactory;
     delete circle;
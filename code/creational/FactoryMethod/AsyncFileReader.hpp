@@ -0,0 +1,482 @@
+#ifndef ASYNC_FILE_READER_HPP
+#define ASYNC_FILE_READER_HPP
+
+/*
+Reads many whole files with a bounded number of reads in flight and hands
+each one over, as a MappedFile owning the bytes, as soon as it is complete.
+
+The Linux backend is io_uring, driven through the raw system calls (no
+liburing): every file gets one IORING_OP_READ into a buffer of its size,
+short reads are resubmitted for the remainder, and one io_uring_enter both
+submits new reads and waits for completions. Opening and fstat-ing a file
+stay synchronous; they are cheap next to a cold read.
+
+When io_uring is unavailable (old kernel, seccomp, io_uring_disabled) or
+cannot read files (IORING_OP_READ needs 5.6; Open probes for it) the reader
+falls back to blocking pread on its own WorkStealingPool, with the
+same bound on reads in flight. Either way, onLoaded is called on the thread
+that called ReadAll, in completion order.
+*/
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "MappedFile.hpp"
+#include "WorkStealingPool.hpp"
+
+// One file read by AsyncFileReader: the bytes, or why they could not be read.
+struct LoadedFile
+{
+    std::size_t index = 0; // position in the path list
+    std::shared_ptr<const MappedFile> file;
+    std::string error;
+};
+
+// Minimal io_uring: one submission and one completion ring, mapped from the
+// kernel. Only the calling thread touches it.
+class IoUring
+{
+private:
+    int fd = -1;
+    void *sqRing = MAP_FAILED;
+    std::size_t sqRingBytes = 0;
+    void *cqRing = MAP_FAILED;
+    std::size_t cqRingBytes = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    std::size_t sqesBytes = 0;
+
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned *sqArray = nullptr;
+    unsigned sqEntries = 0;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+    unsigned queued = 0; // prepared but not yet submitted
+
+    void Close()
+    {
+        if (sqes != MAP_FAILED)
+            ::munmap(sqes, sqesBytes);
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+            ::munmap(cqRing, cqRingBytes);
+        if (sqRing != MAP_FAILED)
+            ::munmap(sqRing, sqRingBytes);
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+        sqRing = cqRing = MAP_FAILED;
+        sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    }
+
+    static unsigned *At(void *ring, std::uint32_t offset)
+    {
+        return reinterpret_cast<unsigned *>(static_cast<char *>(ring) + offset);
+    }
+
+    // Whether the kernel implements IORING_OP_READ. Kernels without
+    // IORING_REGISTER_PROBE (before 5.6) predate the opcode as well; there
+    // every read would complete with -EINVAL.
+    bool SupportsRead()
+    {
+        constexpr unsigned ProbeOps = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + ProbeOps * sizeof(io_uring_probe_op), 0);
+        io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, ProbeOps) < 0)
+            return false;
+        return IORING_OP_READ <= probe->last_op && IORING_OP_READ < probe->ops_len &&
+               (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+public:
+    IoUring() = default;
+    ~IoUring() { Close(); }
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    // False if the kernel refuses or cannot read files through the ring (the
+    // caller falls back to pread).
+    bool Open(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        long ring = ::syscall(__NR_io_uring_setup, entries, &params);
+        if (ring < 0)
+            return false;
+        fd = static_cast<int>(ring);
+        if (!SupportsRead())
+        {
+            Close();
+            return false;
+        }
+
+        sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+        sqRing = ::mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+        {
+            Close();
+            return false;
+        }
+        cqRing = single ? sqRing
+                        : ::mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                 IORING_OFF_CQ_RING);
+        sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(::mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                  fd, IORING_OFF_SQES));
+        if (cqRing == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            Close();
+            return false;
+        }
+
+        sqHead = At(sqRing, params.sq_off.head);
+        sqTail = At(sqRing, params.sq_off.tail);
+        sqMask = *At(sqRing, params.sq_off.ring_mask);
+        sqArray = At(sqRing, params.sq_off.array);
+        sqEntries = params.sq_entries;
+        cqHead = At(cqRing, params.cq_off.head);
+        cqTail = At(cqRing, params.cq_off.tail);
+        cqMask = *At(cqRing, params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(static_cast<char *>(cqRing) + params.cq_off.cqes);
+        return true;
+    }
+
+    unsigned Entries() const { return sqEntries; }
+
+    // Queues a read of `length` bytes at `offset`; false if the ring is full.
+    bool PrepareRead(int file, char *buffer, unsigned length, std::uint64_t offset, std::uint64_t userData)
+    {
+        unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+            return false;
+        unsigned slot = tail & sqMask;
+        io_uring_sqe &sqe = sqes[slot];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<std::uint64_t>(buffer);
+        sqe.len = length;
+        sqe.off = offset;
+        sqe.user_data = userData;
+        sqArray[slot] = slot;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        queued++;
+        return true;
+    }
+
+    // Submits the queued reads and waits until at least `waitFor` completions
+    // are available.
+    void SubmitAndWait(unsigned waitFor)
+    {
+        for (;;)
+        {
+            long done = ::syscall(__NR_io_uring_enter, fd, queued, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0,
+                                  nullptr, 0);
+            if (done >= 0)
+            {
+                queued -= std::min<unsigned>(queued, static_cast<unsigned>(done));
+                if (queued == 0 || waitFor == 0)
+                    return;
+                continue;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+        }
+    }
+
+    // Calls onCompletion(userData, result) for every available completion.
+    template <typename OnCompletion>
+    unsigned Reap(OnCompletion &&onCompletion)
+    {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; head++, count++)
+        {
+            const io_uring_cqe &cqe = cqes[head & cqMask];
+            std::uint64_t userData = cqe.user_data;
+            int result = cqe.res;
+            __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+            onCompletion(userData, result);
+        }
+        return count;
+    }
+};
+
+class AsyncFileReader
+{
+public:
+    enum class Backend
+    {
+        IoUring,
+        ThreadPool
+    };
+
+private:
+    // Largest single read; bigger files take several.
+    static constexpr unsigned MaxReadBytes = 1u << 30;
+
+    unsigned queueDepth;
+    unsigned fallbackThreads;
+    IoUring ring;
+    Backend backend = Backend::ThreadPool;
+
+    struct OpenFile
+    {
+        int fd = -1;
+        std::unique_ptr<char[]> data;
+        std::size_t size = 0;
+    };
+
+    // Opens the file and allocates its buffer; the error text on failure.
+    static std::string OpenForRead(const std::string &FilePath, OpenFile &open)
+    {
+        open.fd = ::open(FilePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (open.fd < 0)
+            return "Cannot open file: " + FilePath;
+        struct stat info;
+        if (::fstat(open.fd, &info) != 0)
+        {
+            ::close(open.fd);
+            open.fd = -1;
+            return "Cannot open file: " + FilePath;
+        }
+        open.size = static_cast<std::size_t>(info.st_size);
+        open.data.reset(new char[open.size > 0 ? open.size : 1]);
+        return std::string();
+    }
+
+    // Blocking whole-file read, for the fallback backend.
+    static LoadedFile ReadWithPread(std::size_t index, const std::string &FilePath)
+    {
+        LoadedFile loaded;
+        loaded.index = index;
+        OpenFile open;
+        loaded.error = OpenForRead(FilePath, open);
+        if (!loaded.error.empty())
+            return loaded;
+        std::size_t done = 0;
+        while (done < open.size)
+        {
+            ssize_t got = ::pread(open.fd, open.data.get() + done, std::min<std::size_t>(open.size - done, MaxReadBytes),
+                                  static_cast<off_t>(done));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+            {
+                loaded.error = "Cannot read file: " + FilePath;
+                ::close(open.fd);
+                return loaded;
+            }
+            if (got == 0)
+                break; // the file shrank
+            done += static_cast<std::size_t>(got);
+        }
+        ::close(open.fd);
+        loaded.file = MappedFile::Adopt(std::move(open.data), done);
+        return loaded;
+    }
+
+    template <typename OnLoaded>
+    void ReadWithIoUring(const std::vector<std::string> &paths, OnLoaded &onLoaded)
+    {
+        struct Job
+        {
+            std::size_t index = 0;
+            OpenFile open;
+            std::size_t done = 0;
+        };
+        unsigned depth = std::min(queueDepth, ring.Entries());
+        std::vector<Job> jobs(depth);
+        std::vector<unsigned> freeJobs;
+        for (unsigned j = depth; j > 0; j--)
+            freeJobs.push_back(j - 1);
+        unsigned inFlight = 0;
+        std::size_t next = 0;
+        std::deque<LoadedFile> ready; // completed, not yet handed over
+
+        auto queueRead = [&](unsigned j)
+        {
+            Job &job = jobs[j];
+            unsigned length = static_cast<unsigned>(std::min<std::size_t>(job.open.size - job.done, MaxReadBytes));
+            if (!ring.PrepareRead(job.open.fd, job.open.data.get() + job.done, length, job.done, j))
+                throw std::runtime_error("io_uring submission queue full");
+        };
+        auto finish = [&](unsigned j, std::string error)
+        {
+            Job &job = jobs[j];
+            ::close(job.open.fd);
+            LoadedFile loaded;
+            loaded.index = job.index;
+            loaded.error = std::move(error);
+            if (loaded.error.empty())
+                loaded.file = MappedFile::Adopt(std::move(job.open.data), job.done);
+            ready.push_back(std::move(loaded));
+            job = Job();
+            freeJobs.push_back(j);
+            inFlight--;
+        };
+
+        try
+        {
+            while (next < paths.size() || inFlight > 0)
+            {
+                while (!freeJobs.empty() && next < paths.size())
+                {
+                    std::size_t index = next++;
+                    OpenFile open;
+                    std::string error = OpenForRead(paths[index], open);
+                    if (!error.empty() || open.size == 0)
+                    {
+                        if (open.fd >= 0)
+                            ::close(open.fd);
+                        LoadedFile loaded;
+                        loaded.index = index;
+                        loaded.error = std::move(error);
+                        if (loaded.error.empty())
+                            loaded.file = MappedFile::Adopt(std::move(open.data), 0);
+                        ready.push_back(std::move(loaded));
+                        continue;
+                    }
+                    unsigned j = freeJobs.back();
+                    freeJobs.pop_back();
+                    jobs[j].index = index;
+                    jobs[j].open = std::move(open);
+                    inFlight++;
+                    queueRead(j);
+                }
+
+                if (inFlight > 0)
+                {
+                    ring.SubmitAndWait(ready.empty() ? 1 : 0);
+                    ring.Reap([&](std::uint64_t userData, int result)
+                    {
+                        unsigned j = static_cast<unsigned>(userData);
+                        Job &job = jobs[j];
+                        if (result == -EINTR || result == -EAGAIN)
+                        {
+                            queueRead(j);
+                            return;
+                        }
+                        if (result < 0)
+                        {
+                            finish(j, "Cannot read file: " + paths[job.index] + ": " + std::strerror(-result));
+                            return;
+                        }
+                        job.done += static_cast<std::size_t>(result);
+                        if (result == 0 || job.done == job.open.size)
+                            finish(j, std::string()); // a zero read means the file shrank
+                        else
+                            queueRead(j);
+                    });
+                }
+
+                while (!ready.empty())
+                {
+                    LoadedFile loaded = std::move(ready.front());
+                    ready.pop_front();
+                    onLoaded(loaded);
+                }
+            }
+        }
+        catch (...)
+        {
+            // The kernel still writes into the buffers of reads in flight.
+            while (inFlight > 0)
+            {
+                ring.SubmitAndWait(1);
+                ring.Reap([&](std::uint64_t userData, int) { finish(static_cast<unsigned>(userData), "cancelled"); });
+            }
+            throw;
+        }
+    }
+
+    template <typename OnLoaded>
+    void ReadWithThreadPool(const std::vector<std::string> &paths, OnLoaded &onLoaded)
+    {
+        std::mutex mutex;
+        std::condition_variable completed;
+        std::deque<LoadedFile> ready;
+        std::size_t outstanding = 0;
+        WorkStealingPool pool(fallbackThreads);
+        std::size_t next = 0;
+
+        // If onLoaded throws, the pool destructor still finishes the reads in
+        // flight before `ready` goes away.
+        while (next < paths.size() || outstanding > 0)
+        {
+            while (outstanding < queueDepth && next < paths.size())
+            {
+                std::size_t index = next++;
+                outstanding++;
+                pool.Submit([&, index]()
+                {
+                    LoadedFile loaded = ReadWithPread(index, paths[index]);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ready.push_back(std::move(loaded));
+                    }
+                    completed.notify_one();
+                });
+            }
+            LoadedFile loaded;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                completed.wait(lock, [&]() { return !ready.empty(); });
+                loaded = std::move(ready.front());
+                ready.pop_front();
+            }
+            outstanding--;
+            onLoaded(loaded);
+        }
+    }
+
+public:
+    // queueDepth bounds the files being read at once (and buffered ahead of
+    // onLoaded); fallbackThreads sizes the pread pool when io_uring is off.
+    explicit AsyncFileReader(unsigned queueDepth = 64, bool useIoUring = true, unsigned fallbackThreads = 8)
+        : queueDepth(std::max(1u, queueDepth)), fallbackThreads(std::max(1u, fallbackThreads))
+    {
+        if (useIoUring && ring.Open(this->queueDepth))
+            backend = Backend::IoUring;
+    }
+
+    AsyncFileReader(const AsyncFileReader &) = delete;
+    AsyncFileReader &operator=(const AsyncFileReader &) = delete;
+
+    Backend ActiveBackend() const { return backend; }
+    const char *BackendName() const { return backend == Backend::IoUring ? "io_uring" : "pread pool"; }
+
+    // Reads every file and calls onLoaded(LoadedFile &) for each, on this
+    // thread, as reads complete.
+    template <typename OnLoaded>
+    void ReadAll(const std::vector<std::string> &paths, OnLoaded &&onLoaded)
+    {
+        if (backend == Backend::IoUring)
+            ReadWithIoUring(paths, onLoaded);
+        else
+            ReadWithThreadPool(paths, onLoaded);
+    }
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef BATCH_PARSER_HPP
+#define BATCH_PARSER_HPP
+
+/*
+Parses many files at once: BatchParser runs ParseDetected (or ParseLoaded,
+for inputs read ahead by AsyncFileReader) on a work-stealing pool, through
+an optional ParseCache, and hands the results back in input order or as
+they complete.
+*/
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AsyncFileReader.hpp"
+#include "FileParsers.hpp"
+#include "ParseCache.hpp"
+#include "WorkStealingPool.hpp"
+
+inline void PrintCacheStats(const ParseCache &cache)
+{
+    ParseCacheStats stats = cache.Stats();
+    std::cout << "cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions
+              << " evictions, " << stats.bytesSkipped << " input bytes not re-parsed, " << stats.entries
+              << " entries in " << stats.bytes << " bytes" << std::endl;
+}
+
+// Outcome of one file in a batch.
+struct BatchFileResult
+{
+    std::size_t index = 0; // position in the input list
+    std::string path;
+    std::uint64_t bytes = 0;
+    double seconds = 0;
+    std::optional<ParseResult> result; // empty if parsing failed
+    std::string error;
+
+    double MegabytesPerSecond() const { return seconds > 0 ? static_cast<double>(bytes) / 1e6 / seconds : 0; }
+};
+
+struct BatchOptions
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    std::uint64_t maxInFlightBytes = 256ull * 1024 * 1024; // input bytes parsed or waiting to be delivered
+    bool inputOrder = true;                                 // false: deliver each file as it finishes
+    ParseCache *cache = nullptr;                            // reuse results of unchanged files
+    bool asyncRead = false;                                 // read inputs with AsyncFileReader
+    unsigned readDepth = 64;                                // reads in flight when asyncRead
+};
+
+struct BatchSummary
+{
+    std::size_t files = 0;
+    std::size_t failed = 0;
+    std::uint64_t bytes = 0;
+    double seconds = 0;
+    std::uint64_t steals = 0;
+
+    double MegabytesPerSecond() const { return seconds > 0 ? static_cast<double>(bytes) / 1e6 / seconds : 0; }
+};
+
+// Parses many files on a work-stealing pool, each through
+// ParserFactory::detectParser. Results are handed to onResult on the calling
+// thread, in input order or as they complete. A file is only dispatched while
+// the bytes in flight stay under the cap (a larger file runs alone). With
+// asyncRead the inputs are read ahead by AsyncFileReader (up to readDepth
+// files beyond the cap) and parsed from memory.
+class BatchParser
+{
+public:
+    // Files of a directory (recursively, sorted) or the lines of a list file.
+    static std::vector<std::string> ListInputs(const std::string &source)
+    {
+        std::vector<std::string> paths;
+        if (std::filesystem::is_directory(source))
+        {
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(source))
+            {
+                if (entry.is_regular_file())
+                    paths.push_back(entry.path().string());
+            }
+            std::sort(paths.begin(), paths.end());
+            return paths;
+        }
+        std::ifstream list(source);
+        if (!list.is_open())
+            throw std::runtime_error("Cannot open file list: " + source);
+        std::string line;
+        while (std::getline(list, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                paths.push_back(line);
+        }
+        return paths;
+    }
+
+    template <typename OnResult>
+    static BatchSummary Run(const std::vector<std::string> &paths, const BatchOptions &options, OnResult &&onResult)
+    {
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::deque<BatchFileResult> done; // completed, not yet taken by the caller
+        std::vector<std::optional<BatchFileResult>> waiting(options.inputOrder ? paths.size() : 0);
+        std::size_t nextToDeliver = 0;
+        std::uint64_t inFlight = 0; // only touched by the calling thread
+        std::size_t outstanding = 0;
+        BatchSummary summary;
+        summary.files = paths.size();
+
+        auto deliver = [&](BatchFileResult &item)
+        {
+            inFlight -= item.bytes;
+            summary.bytes += item.bytes;
+            if (!item.result)
+                summary.failed++;
+            onResult(item);
+        };
+        // Waits for one completion and delivers what is now deliverable.
+        auto collectOne = [&]()
+        {
+            BatchFileResult item;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait(lock, [&]() { return !done.empty(); });
+                item = std::move(done.front());
+                done.pop_front();
+            }
+            outstanding--;
+            if (!options.inputOrder)
+            {
+                deliver(item);
+                return;
+            }
+            std::size_t index = item.index;
+            waiting[index] = std::move(item);
+            while (nextToDeliver < waiting.size() && waiting[nextToDeliver])
+            {
+                deliver(*waiting[nextToDeliver]);
+                waiting[nextToDeliver++].reset();
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            WorkStealingPool pool(options.threads);
+            // `loaded` is the content when AsyncFileReader read it already.
+            auto dispatch = [&](std::size_t i, std::uint64_t bytes, std::shared_ptr<const MappedFile> loaded,
+                                std::string readError)
+            {
+                while (outstanding > 0 && inFlight + bytes > options.maxInFlightBytes)
+                    collectOne();
+                inFlight += bytes;
+                outstanding++;
+
+                pool.Submit([&, i, bytes, loaded = std::move(loaded), readError = std::move(readError)]()
+                {
+                    BatchFileResult item;
+                    item.index = i;
+                    item.path = paths[i];
+                    item.bytes = bytes;
+                    auto begin = std::chrono::steady_clock::now();
+                    try
+                    {
+                        auto parse = [&](const std::string &FilePath)
+                        {
+                            return loaded ? ParseLoaded(FilePath, loaded) : ParseDetected(FilePath);
+                        };
+                        if (!readError.empty())
+                            item.error = readError;
+                        else if (options.cache)
+                            item.result.emplace(options.cache->GetOrParse(paths[i], parse));
+                        else
+                            item.result.emplace(parse(paths[i]));
+                    }
+                    catch (const std::exception &ex)
+                    {
+                        item.error = ex.what();
+                    }
+                    item.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        done.push_back(std::move(item));
+                    }
+                    finished.notify_one();
+                });
+            };
+
+            if (options.asyncRead)
+            {
+                AsyncFileReader reader(options.readDepth);
+                reader.ReadAll(paths, [&](LoadedFile &file)
+                {
+                    std::uint64_t bytes = file.file ? file.file->View().size() : 0;
+                    dispatch(file.index, bytes, std::move(file.file), std::move(file.error));
+                });
+            }
+            else
+            {
+                for (std::size_t i = 0; i < paths.size(); i++)
+                {
+                    std::error_code ec;
+                    std::uint64_t bytes = std::filesystem::file_size(paths[i], ec);
+                    if (ec)
+                        bytes = 0;
+                    dispatch(i, bytes, nullptr, std::string());
+                }
+            }
+            while (outstanding > 0)
+                collectOne();
+            summary.steals = pool.Steals();
+        }
+        summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return summary;
+    }
+
+    // Collects every result, in input order.
+    static std::vector<BatchFileResult> Run(const std::vector<std::string> &paths, BatchOptions options,
+                                            BatchSummary *summary = nullptr)
+    {
+        std::vector<BatchFileResult> results;
+        results.reserve(paths.size());
+        options.inputOrder = true;
+        BatchSummary total = Run(paths, options, [&](BatchFileResult &item) { results.push_back(std::move(item)); });
+        if (summary)
+            *summary = total;
+        return results;
+    }
+};
+
+#endif
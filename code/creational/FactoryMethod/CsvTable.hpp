@@ -0,0 +1,799 @@
+#ifndef CSV_TABLE_HPP
+#define CSV_TABLE_HPP
+
+/*
+Columnar CSV engine used by CsvParser, which checks records with it and
+emits the input text unchanged.
+
+The input is classified 64 bytes at a time into quote, delimiter and newline
+bitmasks by the same runtime-selected kernels as the JSON scanner (AVX2, SSE2
+or scalar). A prefix-xor over the quote mask marks quoted regions, so
+delimiters and newlines inside quotes drop out with one and-not; a doubled
+quote ("") toggles twice and needs no special case. What remains are the
+field separators, visited in order without materializing an index array.
+
+CsvTable::Parse keeps only the fields of the requested columns, infers each
+column's type and stores it as one contiguous buffer per column. A column is
+int64 or double only if every value is written exactly as ToCsv writes it
+back ("00501", "+7", "1.50" or "1e3" keep it a string), so re-emitting never
+changes the text; empty fields are nulls and do not vote. CsvTable::Check
+makes the same record checks without converting anything. CountCsvRows only
+counts unquoted newlines, which is enough to answer "how many rows".
+
+Rows end at "\n" or "\r\n"; empty lines are skipped by both paths.
+
+CsvTable::ParseParallel splits a large body into byte ranges at record
+boundaries (see SplitCsvRecords), scans the ranges and converts the columns on
+a WorkStealingPool, and stitches the per-range results together in order.
+*/
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include "JsonDocument.hpp"
+#include "WorkStealingPool.hpp"
+
+struct CsvOptions
+{
+    char delimiter = ',';
+    bool hasHeader = true;
+    std::vector<std::string> columns; // projection by header name; empty = all columns
+};
+
+// Character classes of one 64 byte block, bit i = byte i.
+struct CsvBlockMasks
+{
+    std::uint64_t quote;
+    std::uint64_t delimiter;
+    std::uint64_t newline; // '\n'
+    std::uint64_t carriage; // '\r'
+};
+
+inline void ClassifyCsvBlocksScalar(const char *data, std::size_t blocks, char delimiter, CsvBlockMasks *out)
+{
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+        CsvBlockMasks masks{0, 0, 0, 0};
+        const char *block = data + b * 64;
+        for (int i = 0; i < 64; i++)
+        {
+            std::uint64_t bit = std::uint64_t(1) << i;
+            char c = block[i];
+            if (c == '"')
+                masks.quote |= bit;
+            else if (c == delimiter)
+                masks.delimiter |= bit;
+            else if (c == '\n')
+                masks.newline |= bit;
+            else if (c == '\r')
+                masks.carriage |= bit;
+        }
+        out[b] = masks;
+    }
+}
+
+#ifdef JSON_HAVE_X86
+__attribute__((target("sse2"))) inline void ClassifyCsvBlocksSse2(const char *data, std::size_t blocks, char delimiter, CsvBlockMasks *out)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i separator = _mm_set1_epi8(delimiter);
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+        CsvBlockMasks masks{0, 0, 0, 0};
+        for (int part = 0; part < 4; part++)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + b * 64 + part * 16));
+            int shift = part * 16;
+            masks.quote |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)))) << shift;
+            masks.delimiter |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, separator)))) << shift;
+            masks.newline |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)))) << shift;
+            masks.carriage |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, carriage)))) << shift;
+        }
+        out[b] = masks;
+    }
+}
+
+__attribute__((target("avx2"))) inline void ClassifyCsvBlocksAvx2(const char *data, std::size_t blocks, char delimiter, CsvBlockMasks *out)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i separator = _mm256_set1_epi8(delimiter);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+        CsvBlockMasks masks{0, 0, 0, 0};
+        for (int part = 0; part < 2; part++)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + b * 64 + part * 32));
+            int shift = part * 32;
+            masks.quote |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)))) << shift;
+            masks.delimiter |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, separator)))) << shift;
+            masks.newline |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)))) << shift;
+            masks.carriage |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, carriage)))) << shift;
+        }
+        out[b] = masks;
+    }
+}
+#endif
+
+inline void ClassifyCsvBlocks(JsonKernel kernel, const char *data, std::size_t blocks, char delimiter, CsvBlockMasks *out)
+{
+#ifdef JSON_HAVE_X86
+    if (kernel == JsonKernel::Avx2)
+        return ClassifyCsvBlocksAvx2(data, blocks, delimiter, out);
+    if (kernel == JsonKernel::Sse2)
+        return ClassifyCsvBlocksSse2(data, blocks, delimiter, out);
+#endif
+    (void)kernel;
+    ClassifyCsvBlocksScalar(data, blocks, delimiter, out);
+}
+
+// Classifies `text` chunk by chunk and calls onBlock(base, masks, inQuote)
+// for every 64 byte block; the last block is padded with NUL bytes. Returns
+// whether the text ends inside quotes.
+template <typename OnBlock>
+inline bool ScanCsvBlocks(std::string_view text, char delimiter, JsonKernel kernel, OnBlock &&onBlock)
+{
+    const std::size_t ChunkBlocks = 1024; // 64 KiB of input per kernel call
+    std::vector<CsvBlockMasks> masks(std::min(ChunkBlocks, (text.size() + 63) / 64));
+    char tail[64];
+    std::uint64_t inQuoteCarry = 0; // all ones if the previous block ended inside quotes
+
+    std::size_t fullBlocks = text.size() / 64;
+    std::size_t totalBlocks = (text.size() + 63) / 64;
+    for (std::size_t first = 0; first < totalBlocks; first += ChunkBlocks)
+    {
+        std::size_t count = std::min(ChunkBlocks, totalBlocks - first);
+        std::size_t full = first < fullBlocks ? std::min(count, fullBlocks - first) : 0;
+        ClassifyCsvBlocks(kernel, text.data() + first * 64, full, delimiter, masks.data());
+        if (full < count)
+        {
+            std::size_t rest = text.size() - fullBlocks * 64;
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, text.data() + fullBlocks * 64, rest);
+            ClassifyCsvBlocks(kernel, tail, 1, delimiter, masks.data() + full);
+        }
+
+        for (std::size_t b = 0; b < count; b++)
+        {
+            std::uint64_t inQuote = PrefixXor(masks[b].quote) ^ inQuoteCarry;
+            inQuoteCarry = static_cast<std::uint64_t>(static_cast<std::int64_t>(inQuote) >> 63);
+            onBlock((first + b) * 64, masks[b], inQuote);
+        }
+    }
+    return inQuoteCarry != 0;
+}
+
+// Calls onField(begin, end, endOfRow) for every field in input order. `end`
+// excludes the separator and a trailing '\r'; quotes are left in place.
+template <typename OnField>
+inline void ForEachCsvField(std::string_view text, char delimiter, JsonKernel kernel, OnField &&onField)
+{
+    std::size_t fieldStart = 0;
+    bool unterminated = ScanCsvBlocks(text, delimiter, kernel, [&](std::size_t base, const CsvBlockMasks &m, std::uint64_t inQuote)
+    {
+        std::uint64_t separators = (m.delimiter | m.newline) & ~inQuote;
+        while (separators)
+        {
+            std::size_t pos = base + static_cast<std::size_t>(__builtin_ctzll(separators));
+            separators &= separators - 1;
+            bool endOfRow = text[pos] == '\n';
+            std::size_t end = pos;
+            if (endOfRow && end > fieldStart && text[end - 1] == '\r')
+                end--;
+            onField(fieldStart, end, endOfRow);
+            fieldStart = pos + 1;
+        }
+    });
+    if (unterminated)
+        throw std::runtime_error("Invalid CSV: unterminated quoted field");
+    if (fieldStart < text.size())
+    {
+        std::size_t end = text.size();
+        if (text[end - 1] == '\r')
+            end--;
+        onField(fieldStart, end, true);
+    }
+}
+
+// Row-count fast path: counts unquoted line ends, skipping empty lines,
+// without looking at any field. Excludes the header row if there is one.
+inline std::size_t CountCsvRows(std::string_view text, const CsvOptions &options = CsvOptions(),
+                                JsonKernel kernel = BestJsonKernel())
+{
+    std::size_t lines = 0;
+    // Bits for the bytes just before this block; the start of the input
+    // behaves like a preceding "\n".
+    std::uint64_t newlineCarry = 1;  // bit 0: byte -1 is '\n'
+    std::uint64_t newlineCarry2 = 2; // bits 0-1: bytes -2 and -1 are '\n'
+    std::uint64_t carriageCarry = 0; // bit 0: byte -1 is '\r'
+    bool unterminated = ScanCsvBlocks(text, options.delimiter, kernel, [&](std::size_t, const CsvBlockMasks &m, std::uint64_t inQuote)
+    {
+        std::uint64_t ends = m.newline & ~inQuote;
+        std::uint64_t afterNewline = (ends << 1) | newlineCarry;
+        std::uint64_t afterCarriage = (m.carriage << 1) | carriageCarry;
+        std::uint64_t twoAfterNewline = (ends << 2) | newlineCarry2;
+        std::uint64_t empty = ends & (afterNewline | (afterCarriage & twoAfterNewline));
+        lines += static_cast<std::size_t>(__builtin_popcountll(ends & ~empty));
+        newlineCarry = ends >> 63;
+        newlineCarry2 = ends >> 62;
+        carriageCarry = m.carriage >> 63;
+    });
+    if (unterminated)
+        throw std::runtime_error("Invalid CSV: unterminated quoted field");
+
+    // A last line without a line end, unless it is only a '\r'.
+    if (!text.empty() && text.back() != '\n')
+    {
+        std::size_t lineStart = text.find_last_of('\n');
+        lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+        if (text.substr(lineStart) != "\r")
+            lines++;
+    }
+    if (options.hasHeader && lines > 0)
+        lines--;
+    return lines;
+}
+
+enum class CsvType : char
+{
+    Int64,
+    Double,
+    String
+};
+
+inline const char *CsvTypeName(CsvType type)
+{
+    switch (type)
+    {
+    case CsvType::Int64:
+        return "int64";
+    case CsvType::Double:
+        return "double";
+    case CsvType::String:
+        return "string";
+    }
+    return "unknown";
+}
+
+// One column, stored contiguously in the buffer that matches its type.
+class CsvColumn
+{
+private:
+    std::string name;
+    CsvType type = CsvType::Int64;
+    std::vector<std::int64_t> ints;
+    std::vector<double> doubles;
+    std::string chars;                  // string values back to back
+    std::vector<std::uint64_t> offsets; // value i is chars[offsets[i], offsets[i + 1])
+    std::vector<std::uint8_t> present;  // 0 for an empty (null) field
+
+    friend class CsvTable;
+
+public:
+    const std::string &Name() const { return name; }
+    CsvType Type() const { return type; }
+    std::size_t Size() const { return present.size(); }
+
+    bool IsNull(std::size_t row) const { return !present[row]; }
+    std::int64_t Int64(std::size_t row) const { return ints[row]; }
+    double Double(std::size_t row) const { return type == CsvType::Int64 ? static_cast<double>(ints[row]) : doubles[row]; }
+    std::string_view String(std::size_t row) const
+    {
+        return std::string_view(chars).substr(offsets[row], offsets[row + 1] - offsets[row]);
+    }
+
+    // Raw contiguous buffers, for vectorized consumers.
+    const std::vector<std::int64_t> &Int64Data() const { return ints; }
+    const std::vector<double> &DoubleData() const { return doubles; }
+};
+
+class CsvTable
+{
+private:
+    struct FieldSpan
+    {
+        std::uint64_t begin;
+        std::uint64_t end;
+    };
+
+    // Fields of one byte range of the body, per projected column.
+    struct CsvRange
+    {
+        std::size_t begin;
+        std::size_t end;
+        std::vector<std::vector<FieldSpan>> spans;
+        std::size_t rows = 0;
+    };
+
+    std::vector<CsvColumn> columns;
+    std::size_t rows = 0;
+
+    static std::string_view Unquoted(std::string_view field, std::string &scratch)
+    {
+        if (field.size() < 2 || field.front() != '"' || field.back() != '"')
+            return field;
+        field = field.substr(1, field.size() - 2);
+        if (field.find('"') == std::string_view::npos)
+            return field;
+        scratch.clear();
+        for (std::size_t i = 0; i < field.size(); i++)
+        {
+            scratch += field[i];
+            if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"')
+                i++;
+        }
+        return scratch;
+    }
+
+    static bool IsInt64(std::string_view value, std::int64_t &out)
+    {
+        const char *end = value.data() + value.size();
+        auto result = std::from_chars(value.data(), end, out);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    static bool IsDouble(std::string_view value, double &out)
+    {
+        const char *end = value.data() + value.size();
+        auto result = std::from_chars(value.data(), end, out);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // The text ToCsv writes for a value.
+    static std::string_view FormatInt64(std::int64_t value, char (&buffer)[32])
+    {
+        return std::string_view(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+    }
+
+    static std::string_view FormatDouble(double value, char (&buffer)[32])
+    {
+        char *end = std::to_chars(buffer, buffer + sizeof(buffer) - 2, value).ptr;
+        if (std::string_view(buffer, end - buffer).find_first_of(".eEin") == std::string_view::npos)
+        {
+            *end++ = '.'; // keep the value recognisable as a double
+            *end++ = '0';
+        }
+        return std::string_view(buffer, end - buffer);
+    }
+
+    // Bits of InferFits: every non-empty field reads as, and is written back
+    // unchanged from, that type.
+    static constexpr std::uint8_t FitsInt64 = 1;
+    static constexpr std::uint8_t FitsDouble = 2;
+
+    // body(i) for i in [0, count), on the pool if there is one.
+    template <typename Body>
+    static void RunFor(WorkStealingPool *pool, std::size_t count, Body &&body)
+    {
+        if (pool && count > 1)
+            return pool->ParallelFor(count, body);
+        for (std::size_t i = 0; i < count; i++)
+            body(i);
+    }
+
+    static std::size_t ReadHeader(std::string_view text, const CsvOptions &options, JsonKernel kernel,
+                                  std::vector<std::string> &header);
+    static void CollectRange(std::string_view text, CsvRange &range, const std::vector<int> &slotOf,
+                             char delimiter, JsonKernel kernel);
+    static std::uint8_t InferFits(std::string_view text, const std::vector<FieldSpan> &spans);
+    static std::vector<CsvRange> CollectRanges(std::string_view text, std::size_t bodyStart,
+                                               const std::vector<int> &slotOf, std::size_t slots,
+                                               const CsvOptions &options, JsonKernel kernel, WorkStealingPool *pool,
+                                               std::size_t minRangeBytes);
+    static void Materialize(std::vector<CsvColumn> &columns, std::string_view text, std::vector<CsvRange> &ranges,
+                            std::size_t rows, WorkStealingPool *pool);
+    static CsvTable ParseWith(std::string_view text, const CsvOptions &options, JsonKernel kernel,
+                              WorkStealingPool *pool, std::size_t minRangeBytes);
+
+public:
+    static CsvTable Parse(std::string_view text, const CsvOptions &options = CsvOptions(),
+                          JsonKernel kernel = BestJsonKernel())
+    {
+        return ParseWith(text, options, kernel, nullptr, 0);
+    }
+
+    // Same result as Parse, with the body split at record boundaries into
+    // ranges of at least minRangeBytes that are scanned and converted on `pool`.
+    static CsvTable ParseParallel(std::string_view text, WorkStealingPool &pool, const CsvOptions &options = CsvOptions(),
+                                  std::size_t minRangeBytes = 4 * 1024 * 1024, JsonKernel kernel = BestJsonKernel())
+    {
+        return ParseWith(text, options, kernel, &pool, minRangeBytes);
+    }
+
+    // Makes the record checks of ParseParallel (every record has as many
+    // fields as the header) without keeping any field; returns the row count.
+    static std::size_t Check(std::string_view text, WorkStealingPool &pool, const CsvOptions &options = CsvOptions(),
+                             std::size_t minRangeBytes = 4 * 1024 * 1024, JsonKernel kernel = BestJsonKernel());
+
+    std::size_t Rows() const { return rows; }
+    std::size_t ColumnCount() const { return columns.size(); }
+    const CsvColumn &Column(std::size_t i) const { return columns[i]; }
+    const CsvColumn &Column(std::string_view name) const;
+
+    // Re-encodes the table as CSV with a header row.
+    std::string ToCsv(char delimiter = ',') const;
+};
+
+// Offset just past the first unquoted '\n' at or after `from`, given whether
+// `from` is inside quotes; text.size() if there is none.
+inline std::size_t NextCsvRecordStart(std::string_view text, std::size_t from, bool inQuote)
+{
+    for (std::size_t i = from; i < text.size(); i++)
+    {
+        if (text[i] == '"')
+            inQuote = !inQuote;
+        else if (text[i] == '\n' && !inQuote)
+            return i + 1;
+    }
+    return text.size();
+}
+
+// Cuts text[from, end) into at most `parts` ranges that each begin at a record
+// boundary. The quote parity at each cut comes from the quote counts of all
+// earlier ranges (a doubled quote counts twice, so it cancels out), which
+// makes a newline inside a quoted field impossible to mistake for a boundary.
+inline std::vector<std::size_t> SplitCsvRecords(std::string_view text, std::size_t from, std::size_t parts,
+                                                char delimiter, JsonKernel kernel, WorkStealingPool &pool)
+{
+    std::size_t length = text.size() - from;
+    parts = std::max<std::size_t>(1, std::min(parts, length));
+    std::vector<std::size_t> cuts(parts + 1);
+    for (std::size_t k = 0; k <= parts; k++)
+        cuts[k] = from + length / parts * k;
+    cuts[parts] = text.size();
+
+    std::vector<std::uint64_t> quotes(parts, 0);
+    pool.ParallelFor(parts, [&](std::size_t k)
+    {
+        ScanCsvBlocks(text.substr(cuts[k], cuts[k + 1] - cuts[k]), delimiter, kernel,
+                      [&](std::size_t, const CsvBlockMasks &m, std::uint64_t)
+                      { quotes[k] += static_cast<std::uint64_t>(__builtin_popcountll(m.quote)); });
+    });
+
+    std::vector<bool> inQuote(parts, false);
+    for (std::size_t k = 1; k < parts; k++)
+        inQuote[k] = inQuote[k - 1] != (quotes[k - 1] % 2 == 1);
+
+    std::vector<std::size_t> boundaries(parts + 1);
+    boundaries[0] = from;
+    boundaries[parts] = text.size();
+    pool.ParallelFor(parts - 1, [&](std::size_t i)
+    {
+        boundaries[i + 1] = NextCsvRecordStart(text, cuts[i + 1], inQuote[i + 1]);
+    });
+
+    // A record longer than a range swallows the cuts inside it.
+    std::vector<std::size_t> result = {from};
+    for (std::size_t k = 1; k <= parts; k++)
+    {
+        if (boundaries[k] > result.back())
+            result.push_back(boundaries[k]);
+    }
+    if (result.back() != text.size())
+        result.push_back(text.size());
+    return result;
+}
+
+// Offset where the body starts; fills `header` with the column names (or
+// column1..N without a header row, in which case the first row is body).
+inline std::size_t CsvTable::ReadHeader(std::string_view text, const CsvOptions &options, JsonKernel kernel,
+                                        std::vector<std::string> &header)
+{
+    std::size_t rowStart = 0;
+    std::size_t rowEnd = text.substr(0, 3) == "\xEF\xBB\xBF" ? 3 : 0; // skip a UTF-8 byte order mark
+    for (;;)
+    {
+        rowStart = rowEnd;
+        if (rowStart == text.size())
+            return rowStart; // no rows at all
+        rowEnd = NextCsvRecordStart(text, rowStart, false);
+        std::string_view row = text.substr(rowStart, rowEnd - rowStart);
+        if (row != "\n" && row != "\r\n" && row != "\r")
+            break; // skip empty lines
+    }
+
+    std::string scratch;
+    ForEachCsvField(text.substr(rowStart, rowEnd - rowStart), options.delimiter, kernel,
+                    [&](std::size_t begin, std::size_t end, bool)
+                    {
+                        std::string_view value = text.substr(rowStart + begin, end - begin);
+                        header.emplace_back(options.hasHeader ? std::string(Unquoted(value, scratch))
+                                                              : "column" + std::to_string(header.size() + 1));
+                    });
+    return options.hasHeader ? rowEnd : rowStart;
+}
+
+inline void CsvTable::CollectRange(std::string_view text, CsvRange &range, const std::vector<int> &slotOf,
+                                   char delimiter, JsonKernel kernel)
+{
+    std::size_t expected = slotOf.size();
+    std::size_t field = 0; // index of the current field in its row
+    std::size_t rowStart = range.begin;
+    std::string_view body = text.substr(range.begin, range.end - range.begin);
+
+    auto fail = [&](const std::string &what)
+    {
+        throw std::runtime_error("Invalid CSV at offset " + std::to_string(rowStart) + ": " + what);
+    };
+
+    ForEachCsvField(body, delimiter, kernel, [&](std::size_t begin, std::size_t end, bool endOfRow)
+    {
+        begin += range.begin;
+        end += range.begin;
+        if (endOfRow && field == 0 && begin == end)
+        {
+            rowStart = end + 1;
+            return; // empty line
+        }
+        if (field >= expected)
+            fail("record has more than " + std::to_string(expected) + " fields");
+        if (slotOf[field] >= 0)
+            range.spans[slotOf[field]].push_back({begin, end});
+        field++;
+        if (endOfRow)
+        {
+            if (field != expected)
+                fail("record has " + std::to_string(field) + " fields, expected " + std::to_string(expected));
+            field = 0;
+            range.rows++;
+            rowStart = end + 1;
+        }
+    });
+}
+
+// The numeric types (FitsInt64, FitsDouble) that hold every non-empty field
+// and write it back as the same text; a column of only nulls fits both.
+inline std::uint8_t CsvTable::InferFits(std::string_view text, const std::vector<FieldSpan> &spans)
+{
+    std::int64_t intValue;
+    double doubleValue;
+    char buffer[32];
+    std::uint8_t fits = FitsInt64 | FitsDouble;
+    for (const FieldSpan &span : spans)
+    {
+        std::string_view field = text.substr(span.begin, span.end - span.begin);
+        if (field.empty())
+            continue;
+        if (field.front() == '"')
+            return 0; // quoted fields are always text
+        if ((fits & FitsInt64) && !(IsInt64(field, intValue) && FormatInt64(intValue, buffer) == field))
+            fits &= ~FitsInt64;
+        if ((fits & FitsDouble) && !(IsDouble(field, doubleValue) && FormatDouble(doubleValue, buffer) == field))
+            fits &= ~FitsDouble;
+        if (fits == 0)
+            return 0;
+    }
+    return fits;
+}
+
+// Infers every column's type from all ranges, then converts each range
+// straight into its rows of the column buffers.
+inline void CsvTable::Materialize(std::vector<CsvColumn> &columns, std::string_view text,
+                                  std::vector<CsvRange> &ranges, std::size_t rows, WorkStealingPool *pool)
+{
+    std::size_t rangeCount = ranges.size();
+    std::vector<std::size_t> firstRow(rangeCount, 0);
+    for (std::size_t r = 1; r < rangeCount; r++)
+        firstRow[r] = firstRow[r - 1] + ranges[r - 1].rows;
+
+    std::vector<std::uint8_t> fits(columns.size() * rangeCount);
+    RunFor(pool, fits.size(), [&](std::size_t i)
+    {
+        fits[i] = InferFits(text, ranges[i % rangeCount].spans[i / rangeCount]);
+    });
+
+    for (std::size_t c = 0; c < columns.size(); c++)
+    {
+        CsvColumn &column = columns[c];
+        std::uint8_t columnFits = FitsInt64 | FitsDouble;
+        for (std::size_t r = 0; r < rangeCount; r++)
+            columnFits &= fits[c * rangeCount + r];
+        column.type = (columnFits & FitsInt64)    ? CsvType::Int64
+                      : (columnFits & FitsDouble) ? CsvType::Double
+                                                  : CsvType::String;
+        column.present.resize(rows);
+        if (column.type == CsvType::Int64)
+            column.ints.resize(rows);
+        else if (column.type == CsvType::Double)
+            column.doubles.resize(rows);
+        else
+            column.offsets.resize(rows + 1);
+    }
+
+    // String columns are built per range and stitched together afterwards.
+    std::vector<std::string> rangeChars(columns.size() * rangeCount);
+    RunFor(pool, columns.size() * rangeCount, [&](std::size_t i)
+    {
+        CsvColumn &column = columns[i / rangeCount];
+        const std::vector<FieldSpan> &spans = ranges[i % rangeCount].spans[i / rangeCount];
+        std::size_t row = firstRow[i % rangeCount];
+        std::string scratch;
+        for (const FieldSpan &span : spans)
+        {
+            std::string_view field = text.substr(span.begin, span.end - span.begin);
+            column.present[row] = !field.empty();
+            switch (column.type)
+            {
+            case CsvType::Int64:
+                if (!field.empty())
+                    IsInt64(field, column.ints[row]);
+                break;
+            case CsvType::Double:
+                if (!field.empty())
+                    IsDouble(field, column.doubles[row]);
+                break;
+            case CsvType::String:
+                column.offsets[row] = rangeChars[i].size(); // relative to the range for now
+                rangeChars[i] += Unquoted(field, scratch);
+                break;
+            }
+            row++;
+        }
+        std::vector<FieldSpan>().swap(ranges[i % rangeCount].spans[i / rangeCount]);
+    });
+
+    RunFor(pool, columns.size(), [&](std::size_t c)
+    {
+        CsvColumn &column = columns[c];
+        if (column.type != CsvType::String)
+            return;
+        std::size_t total = 0;
+        for (std::size_t r = 0; r < rangeCount; r++)
+            total += rangeChars[c * rangeCount + r].size();
+        column.chars.reserve(total);
+        for (std::size_t r = 0; r < rangeCount; r++)
+        {
+            std::uint64_t base = column.chars.size();
+            for (std::size_t row = firstRow[r]; row < firstRow[r] + ranges[r].rows; row++)
+                column.offsets[row] += base;
+            column.chars += rangeChars[c * rangeCount + r];
+            std::string().swap(rangeChars[c * rangeCount + r]);
+        }
+        column.offsets[rows] = column.chars.size();
+    });
+}
+
+inline CsvTable CsvTable::ParseWith(std::string_view text, const CsvOptions &options, JsonKernel kernel,
+                                    WorkStealingPool *pool, std::size_t minRangeBytes)
+{
+    CsvTable table;
+    std::vector<std::string> header;
+    std::size_t bodyStart = ReadHeader(text, options, kernel, header);
+
+    std::vector<std::string> wanted = options.columns.empty() ? header : options.columns;
+    std::vector<int> slotOf(header.size(), -1); // input column -> projected slot, or -1
+    for (const std::string &name : wanted)
+    {
+        // The first input column of that name not taken yet, so repeated
+        // header names ("a,a,b") each keep their own column.
+        std::size_t at = 0;
+        while (at < header.size() && (slotOf[at] >= 0 || header[at] != name))
+            at++;
+        if (at == header.size())
+            throw std::invalid_argument("CSV column not found: " + name);
+        slotOf[at] = static_cast<int>(table.columns.size());
+        table.columns.emplace_back();
+        table.columns.back().name = name;
+    }
+
+    std::vector<CsvRange> ranges =
+        CollectRanges(text, bodyStart, slotOf, table.columns.size(), options, kernel, pool, minRangeBytes);
+    for (const CsvRange &range : ranges)
+        table.rows += range.rows;
+    Materialize(table.columns, text, ranges, table.rows, pool);
+    return table;
+}
+
+// Splits the body into record ranges (one without a pool or for a small
+// body) and collects the fields of the `slots` projected columns of each.
+inline std::vector<CsvTable::CsvRange> CsvTable::CollectRanges(std::string_view text, std::size_t bodyStart,
+                                                               const std::vector<int> &slotOf, std::size_t slots,
+                                                               const CsvOptions &options, JsonKernel kernel,
+                                                               WorkStealingPool *pool, std::size_t minRangeBytes)
+{
+    std::vector<std::size_t> boundaries = {bodyStart, text.size()};
+    if (pool && text.size() - bodyStart > 2 * minRangeBytes)
+    {
+        std::size_t parts = std::min(pool->ThreadCount() * 4, (text.size() - bodyStart) / minRangeBytes);
+        boundaries = SplitCsvRecords(text, bodyStart, parts, options.delimiter, kernel, *pool);
+    }
+
+    std::vector<CsvRange> ranges(boundaries.size() - 1);
+    RunFor(pool, ranges.size(), [&](std::size_t r)
+    {
+        ranges[r].begin = boundaries[r];
+        ranges[r].end = boundaries[r + 1];
+        ranges[r].spans.resize(slots);
+        CollectRange(text, ranges[r], slotOf, options.delimiter, kernel);
+    });
+    return ranges;
+}
+
+inline std::size_t CsvTable::Check(std::string_view text, WorkStealingPool &pool, const CsvOptions &options,
+                                   std::size_t minRangeBytes, JsonKernel kernel)
+{
+    std::vector<std::string> header;
+    std::size_t bodyStart = ReadHeader(text, options, kernel, header);
+    std::vector<int> slotOf(header.size(), -1); // no column is kept
+    std::size_t rows = 0;
+    for (const CsvRange &range : CollectRanges(text, bodyStart, slotOf, 0, options, kernel, &pool, minRangeBytes))
+        rows += range.rows;
+    return rows;
+}
+
+inline const CsvColumn &CsvTable::Column(std::string_view name) const
+{
+    for (const CsvColumn &column : columns)
+    {
+        if (column.name == name)
+            return column;
+    }
+    throw std::invalid_argument("CSV column not found: " + std::string(name));
+}
+
+inline void AppendCsvField(std::string &out, std::string_view value, char delimiter)
+{
+    if (value.find_first_of(std::string{'"', '\n', '\r', delimiter}) == std::string_view::npos)
+    {
+        out += value;
+        return;
+    }
+    out += '"';
+    for (char c : value)
+    {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+inline std::string CsvTable::ToCsv(char delimiter) const
+{
+    std::string out;
+    char buffer[32];
+    for (std::size_t c = 0; c < columns.size(); c++)
+    {
+        if (c)
+            out += delimiter;
+        AppendCsvField(out, columns[c].name, delimiter);
+    }
+    out += '\n';
+
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        for (std::size_t c = 0; c < columns.size(); c++)
+        {
+            const CsvColumn &column = columns[c];
+            if (c)
+                out += delimiter;
+            if (column.IsNull(row))
+                continue;
+            switch (column.type)
+            {
+            case CsvType::Int64:
+                out += FormatInt64(column.ints[row], buffer);
+                break;
+            case CsvType::Double:
+                out += FormatDouble(column.doubles[row], buffer);
+                break;
+            case CsvType::String:
+                AppendCsvField(out, column.String(row), delimiter);
+                break;
+            }
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+#endif
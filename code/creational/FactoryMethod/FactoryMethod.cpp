@@ -1,5 +1,14 @@
 #include <iostream>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <variant>
+#include <cstdint>
+#include "ObjectPool.hpp"
+#include "TypeListFactory.hpp"
 
 class IOutput
 {
@@ -9,36 +18,80 @@ public:
     virtual ~IOutput() {}
 };
 
-class Led : public IOutput
+static bool quietDevices = false; // the benchmark switches devices without printing
+
+// Devices as plain values: no base class, no vtable. They count how often
+// they were switched on.
+class LedDevice
 {
 private:
+    bool lit = false;
+    unsigned long switchedOn = 0;
+
 public:
-    Led() {}
-    void TurnOn() override
+    void TurnOn()
     {
-        std::cout << "Led Turn On" << std::endl;
+        lit = true;
+        switchedOn++;
+        if (!quietDevices)
+            std::cout << "Led Turn On" << std::endl;
     }
-    void TurnOff() override
+    void TurnOff()
     {
-        std::cout << "Led Turn off" << std::endl;
+        lit = false;
+        if (!quietDevices)
+            std::cout << "Led Turn off" << std::endl;
     }
+    bool IsOn() const { return lit; }
+    unsigned long SwitchedOn() const { return switchedOn; }
 };
 
-class Buzzer : public IOutput
+class BuzzerDevice
 {
 private:
+    bool sounding = false;
+    unsigned long switchedOn = 0;
+
 public:
-    Buzzer() {}
-    void TurnOn() override
+    void TurnOn()
     {
-        std::cout << "Buzzer Turn On" << std::endl;
+        sounding = true;
+        switchedOn++;
+        if (!quietDevices)
+            std::cout << "Buzzer Turn On" << std::endl;
     }
-    void TurnOff() override
+    void TurnOff()
     {
-        std::cout << "Buzzer Turn off" << std::endl;
+        sounding = false;
+        if (!quietDevices)
+            std::cout << "Buzzer Turn off" << std::endl;
     }
+    bool IsOn() const { return sounding; }
+    unsigned long SwitchedOn() const { return switchedOn; }
+};
+
+// A value device behind IOutput, for code that holds devices polymorphically.
+// Plugin devices outside the type list implement IOutput directly.
+template <typename Device>
+class OutputAdapter final : public IOutput
+{
+private:
+    Device device;
+
+public:
+    void TurnOn() override { device.TurnOn(); }
+    void TurnOff() override { device.TurnOff(); }
+    const Device &Get() const { return device; }
 };
 
+using Led = OutputAdapter<LedDevice>;
+using Buzzer = OutputAdapter<BuzzerDevice>;
+
+// The built-in device set, fixed at compile time; the order matches
+// IODeviceFactory::Device.
+using DeviceTypes = TypeList<LedDevice, BuzzerDevice>;
+using StaticDeviceFactory = TypeListFactory<DeviceTypes>;
+
 class IODeviceFactory
 {
 private:
@@ -48,24 +101,191 @@ public:
         LED,
         BUZZER
     };
+    // A pooled device; destroying it gives its slot back to the pool of its type.
+    using PooledDevice = std::unique_ptr<IOutput, PoolDeleter>;
+    // A device by value: no allocation, calls dispatched with std::visit.
+    using DeviceValue = StaticDeviceFactory::Value;
+
     static std::unique_ptr<IOutput> MakeIODeviceFactory(Device object);
+    static PooledDevice MakePooledIODevice(Device object);
+    static DeviceValue MakeDeviceValue(Device object);
 };
 
+static_assert(static_cast<std::size_t>(IODeviceFactory::Device::LED) == StaticDeviceFactory::Index<LedDevice>);
+static_assert(static_cast<std::size_t>(IODeviceFactory::Device::BUZZER) == StaticDeviceFactory::Index<BuzzerDevice>);
+
 std::unique_ptr<IOutput> IODeviceFactory::MakeIODeviceFactory(Device object)
+{
+    std::size_t index = static_cast<std::size_t>(object);
+    if (index >= StaticDeviceFactory::Size)
+    {
+        return nullptr;
+    }
+    return StaticDeviceFactory::MakeUnique<IOutput, OutputAdapter>(index);
+}
+
+IODeviceFactory::DeviceValue IODeviceFactory::MakeDeviceValue(Device object)
+{
+    return StaticDeviceFactory::Make(static_cast<std::size_t>(object));
+}
+
+std::unique_ptr<IOutput, PoolDeleter> IODeviceFactory::MakePooledIODevice(Device object)
 {
     if (Device::LED == object)
     {
-        return std::make_unique<Led>();
+        return ObjectPool<Led>::Make();
     }
     else if (Device::BUZZER == object)
     {
-        return std::make_unique<Buzzer>();
+        return ObjectPool<Buzzer>::Make();
     }
     return nullptr;
 }
 
+// Creates and destroys `devices` devices per thread, alternating LED and
+// buzzer, keeping the last `window` alive (1: each one dies right away).
+template <typename Make>
+static double NanosecondsPerDevice(Make make, int threads, long devices, std::size_t window)
+{
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&]()
+                             {
+            std::vector<decltype(make(IODeviceFactory::Device::LED))> live(window);
+            for (long i = 0; i < devices; i++)
+            {
+                auto device = i % 2 ? IODeviceFactory::Device::BUZZER : IODeviceFactory::Device::LED;
+                live[static_cast<std::size_t>(i) % window] = make(device);
+            } });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(devices); // wall time per device and thread
+}
+
+// Switches a fleet of mixed devices on and off `rounds` times, held three
+// ways: behind IOutput (virtual calls), as DeviceValue (std::visit) and in
+// one array per type (direct calls). The device order is pseudo-random, so
+// neither dispatch gets a fixed pattern to predict.
+static void RunDispatchBenchmark()
+{
+    const std::size_t fleet = 4096;
+    const int rounds = 20000;
+    bool wasQuiet = quietDevices;
+    quietDevices = true;
+
+    std::vector<std::unique_ptr<IOutput>> boxed;
+    std::vector<IODeviceFactory::DeviceValue> values;
+    std::vector<LedDevice> leds;
+    std::vector<BuzzerDevice> buzzers;
+    std::uint32_t state = 12345;
+    for (std::size_t i = 0; i < fleet; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        auto device = (state >> 16) % 2 ? IODeviceFactory::Device::BUZZER : IODeviceFactory::Device::LED;
+        boxed.push_back(IODeviceFactory::MakeIODeviceFactory(device));
+        values.push_back(IODeviceFactory::MakeDeviceValue(device));
+        if (device == IODeviceFactory::Device::LED)
+            leds.emplace_back();
+        else
+            buzzers.emplace_back();
+    }
+
+    auto timed = [&](auto &&pass)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            pass();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (static_cast<double>(fleet) * rounds * 2); // per call
+    };
+    double virtualCall = timed([&]()
+                               {
+        for (auto &device : boxed)
+        {
+            device->TurnOn();
+            device->TurnOff();
+        } });
+    double visitCall = timed([&]()
+                             {
+        for (auto &device : values)
+        {
+            std::visit([](auto &concrete)
+                       {
+                concrete.TurnOn();
+                concrete.TurnOff(); }, device);
+        } });
+    double directCall = timed([&]()
+                              {
+        for (auto &led : leds)
+        {
+            led.TurnOn();
+            led.TurnOff();
+        }
+        for (auto &buzzer : buzzers)
+        {
+            buzzer.TurnOn();
+            buzzer.TurnOff();
+        } });
+
+    unsigned long switched = 0;
+    for (const auto &device : values)
+    {
+        switched += std::visit([](const auto &concrete) { return concrete.SwitchedOn(); }, device);
+    }
+    std::cout << fleet << " devices, " << rounds << " rounds (" << sizeof(std::unique_ptr<IOutput>) << "+"
+              << sizeof(Led) << " bytes boxed, " << sizeof(IODeviceFactory::DeviceValue) << " bytes as a value)"
+              << std::endl;
+    std::cout << "virtual(ns/call)  visit(ns/call)  per-type arrays(ns/call)" << std::endl;
+    std::cout << virtualCall << "\t\t   " << visitCall << "\t   " << directCall << std::endl;
+    std::cout << "calls/s: " << 1e3 / virtualCall << "M virtual, " << 1e3 / visitCall << "M visit, "
+              << 1e3 / directCall << "M direct; visited devices switched on " << switched << " times" << std::endl;
+    quietDevices = wasQuiet;
+}
+
+static void RunBenchmark()
+{
+    const long devices = 20000000;
+    int maxThreads = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    auto heap = [](IODeviceFactory::Device device) { return IODeviceFactory::MakeIODeviceFactory(device); };
+    auto pooled = [](IODeviceFactory::Device device) { return IODeviceFactory::MakePooledIODevice(device); };
+
+    for (std::size_t window : {std::size_t(1), std::size_t(4096)})
+    {
+        std::cout << "live devices per thread: " << window << std::endl;
+        std::cout << "threads  make_unique(ns)  pooled(ns)" << std::endl;
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            std::cout << threads << "\t " << NanosecondsPerDevice(heap, threads, devices, window) << "\t\t   "
+                      << NanosecondsPerDevice(pooled, threads, devices, window) << std::endl;
+        }
+    }
+    std::cout << "pool slabs: " << ObjectPool<Led>::Instance().Slabs() << " Led, "
+              << ObjectPool<Buzzer>::Instance().Slabs() << " Buzzer" << std::endl;
+
+    RunDispatchBenchmark();
+}
+
 int main(int argc, const char **argv)
 {
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+    {
+        RunBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-dispatch")
+    {
+        RunDispatchBenchmark();
+        return 0;
+    }
+
     std::unique_ptr<IOutput> led1 = IODeviceFactory().MakeIODeviceFactory(IODeviceFactory::Device::LED);
     std::unique_ptr<IOutput> buzzer1 = IODeviceFactory().MakeIODeviceFactory(IODeviceFactory::Device::BUZZER);
 
@@ -75,5 +295,15 @@ int main(int argc, const char **argv)
     buzzer1->TurnOn();
     buzzer1->TurnOff();
 
+    IODeviceFactory::PooledDevice led2 = IODeviceFactory::MakePooledIODevice(IODeviceFactory::Device::LED);
+    led2->TurnOn();
+    led2->TurnOff();
+
+    IODeviceFactory::DeviceValue buzzer2 = IODeviceFactory::MakeDeviceValue(IODeviceFactory::Device::BUZZER);
+    std::visit([](auto &device)
+               {
+        device.TurnOn();
+        device.TurnOff(); }, buzzer2);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,520 @@
+#ifndef FILE_PARSERS_HPP
+#define FILE_PARSERS_HPP
+
+/*
+The FileParser products, one per format, and ParserFactory, which picks
+one by extension or by content. Each format registers itself in
+FormatRegistry<FileParser>::Global() next to its class. Shared by the
+Parser program and the ParserBench benchmarks.
+
+ParseDetected parses a file with the parser its content suggests;
+ParseLoaded does the same for a file already read into memory.
+*/
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MappedFile.hpp"
+#include "JsonDocument.hpp"
+#include "CsvTable.hpp"
+#include "XmlReader.hpp"
+#include "WorkStealingPool.hpp"
+#include "FormatRegistry.hpp"
+#include "FormatSniffer.hpp"
+#include "YamlStream.hpp"
+
+// Pool shared by the parsers for chunk-parallel parsing of one large file.
+inline WorkStealingPool &SharedParsePool()
+{
+    static WorkStealingPool pool;
+    return pool;
+}
+
+// Cuts [from, text.size()) into about `parts` ranges that end just after a
+// '\n' (or at the end of the text). Only valid for formats whose records
+// cannot contain a raw newline.
+inline std::vector<std::size_t> SplitAtNewlines(std::string_view text, std::size_t from, std::size_t parts)
+{
+    std::vector<std::size_t> boundaries = {from};
+    std::size_t length = text.size() - from;
+    parts = std::max<std::size_t>(1, parts);
+    for (std::size_t k = 1; k < parts; k++)
+    {
+        std::size_t cut = std::max(from + length / parts * k, boundaries.back());
+        std::size_t newline = text.find('\n', cut);
+        if (newline == std::string_view::npos)
+            break;
+        if (newline + 1 > boundaries.back())
+            boundaries.push_back(newline + 1);
+    }
+    if (boundaries.back() != text.size())
+        boundaries.push_back(text.size());
+    return boundaries;
+}
+
+// Line index of a text file: line i is View()[starts[i], starts[i + 1]),
+// without its line end.
+class TextLines
+{
+public:
+    std::shared_ptr<const MappedFile> file;
+    std::vector<std::size_t> starts; // one per line, plus the end of the text
+
+    std::size_t Count() const { return starts.size() - 1; }
+    std::string_view Line(std::size_t i) const
+    {
+        std::string_view line = file->View().substr(starts[i], starts[i + 1] - starts[i]);
+        if (!line.empty() && line.back() == '\n')
+            line.remove_suffix(1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        return line;
+    }
+};
+
+// parseContent parses input already in memory (mapped, or read by
+// AsyncFileReader); parse maps the file and calls it unless a format can do
+// better from the path.
+class FileParser
+{
+public:
+    virtual ParseResult parseContent(std::shared_ptr<const MappedFile> file) const = 0;
+    virtual ParseResult parse(const std::string &FilePath) const { return parseContent(MappedFile::Open(FilePath)); }
+    virtual ~FileParser() = default;
+};
+
+class TextParser : public FileParser
+{
+public:
+    ParseResult parseContent(std::shared_ptr<const MappedFile> file) const override
+    {
+        std::string_view text = file->View();
+        return ParseResult("Parsed Text File:\n", std::move(file), text);
+    }
+
+    // Splits the file into lines. Files over two ranges are indexed in byte
+    // ranges on the pool: each range counts its newlines, then writes its line
+    // starts at the offset given by the counts of the ranges before it.
+    TextLines parseLines(const std::string &FilePath, WorkStealingPool *pool = &SharedParsePool(),
+                         std::size_t minRangeBytes = 16 * 1024 * 1024) const
+    {
+        TextLines lines;
+        lines.file = MappedFile::Open(FilePath);
+        std::string_view text = lines.file->View();
+
+        std::size_t parts = 1;
+        if (pool && text.size() >= 2 * minRangeBytes)
+            parts = std::min(pool->ThreadCount() * 4, text.size() / minRangeBytes);
+        std::vector<std::size_t> counts(parts, 0);
+        auto rangeOf = [&](std::size_t k) { return text.substr(text.size() / parts * k, k + 1 == parts ? std::string_view::npos : text.size() / parts); };
+        auto runFor = [&](auto &&body)
+        {
+            if (parts > 1)
+                pool->ParallelFor(parts, body);
+            else
+                body(0);
+        };
+
+        runFor([&](std::size_t k)
+        {
+            std::string_view range = rangeOf(k);
+            for (const char *p = range.data(), *end = p + range.size();
+                 (p = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))) != nullptr; p++)
+                counts[k]++;
+        });
+
+        std::vector<std::size_t> firstLine(parts, 1); // line 0 starts at offset 0
+        for (std::size_t k = 1; k < parts; k++)
+            firstLine[k] = firstLine[k - 1] + counts[k - 1];
+        std::size_t total = firstLine[parts - 1] + counts[parts - 1];
+        bool trailingNewline = !text.empty() && text.back() == '\n';
+        lines.starts.resize(trailingNewline || text.empty() ? total : total + 1);
+        lines.starts[0] = 0;
+
+        runFor([&](std::size_t k)
+        {
+            std::string_view range = rangeOf(k);
+            std::size_t base = static_cast<std::size_t>(range.data() - text.data());
+            std::size_t *out = lines.starts.data() + firstLine[k];
+            for (const char *p = range.data(), *end = p + range.size();
+                 (p = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))) != nullptr; p++)
+            {
+                std::size_t next = base + static_cast<std::size_t>(p - range.data()) + 1;
+                if (next < text.size() || !trailingNewline)
+                    *out++ = next;
+            }
+        });
+        lines.starts.back() = text.size();
+        return lines;
+    }
+};
+
+inline FormatRegistration<FileParser> textFormat({"txt"}, std::make_shared<TextParser>());
+
+class JsonParser : public FileParser
+{
+private:
+    bool lines; // newline-delimited JSON: one document per line
+
+public:
+    explicit JsonParser(bool lines = false) : lines(lines) {}
+
+    // Validates the document (or every line) and re-emits it from the tape.
+    ParseResult parseContent(std::shared_ptr<const MappedFile> file) const override
+    {
+        if (!lines)
+            return ParseResult("Parsed JSON File:\n", JsonDocument::Parse(file->View()).Serialize());
+
+        std::string out;
+        for (const JsonDocument &document : ParseJsonLines(file->View(), &SharedParsePool(), 4 * 1024 * 1024))
+        {
+            out += document.Serialize(false);
+            out += '\n';
+        }
+        return ParseResult("Parsed JSON Lines File:\n", std::move(out));
+    }
+
+    JsonDocument parseDocument(const std::string &FilePath) const
+    {
+        auto file = MappedFile::Open(FilePath);
+        return JsonDocument::Parse(file->View());
+    }
+
+    // NDJSON: one document per non-empty line, in file order. A raw newline
+    // cannot occur inside a JSON value, so every '\n' is a safe cut and files
+    // over two ranges are parsed in ranges on the pool.
+    std::vector<JsonDocument> parseLines(const std::string &FilePath, WorkStealingPool *pool = &SharedParsePool(),
+                                         std::size_t minRangeBytes = 4 * 1024 * 1024) const
+    {
+        auto file = MappedFile::Open(FilePath);
+        return ParseJsonLines(file->View(), pool, minRangeBytes);
+    }
+
+    static std::vector<JsonDocument> ParseJsonLines(std::string_view text, WorkStealingPool *pool,
+                                                    std::size_t minRangeBytes)
+    {
+        std::vector<std::size_t> boundaries = {0, text.size()};
+        if (pool && text.size() >= 2 * minRangeBytes)
+            boundaries = SplitAtNewlines(text, 0, std::min(pool->ThreadCount() * 4, text.size() / minRangeBytes));
+
+        std::vector<std::vector<JsonDocument>> parts(boundaries.size() - 1);
+        auto parseRange = [&](std::size_t r)
+        {
+            std::size_t lineStart = boundaries[r];
+            while (lineStart < boundaries[r + 1])
+            {
+                std::size_t lineEnd = text.find('\n', lineStart);
+                if (lineEnd == std::string_view::npos || lineEnd > boundaries[r + 1])
+                    lineEnd = boundaries[r + 1];
+                std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+                if (line.find_first_not_of(" \t\r") != std::string_view::npos)
+                {
+                    try
+                    {
+                        parts[r].push_back(JsonDocument::Parse(line));
+                    }
+                    catch (const std::exception &ex)
+                    {
+                        throw std::runtime_error("JSON line at offset " + std::to_string(lineStart) + ": " + ex.what());
+                    }
+                }
+                lineStart = lineEnd + 1;
+            }
+        };
+        if (parts.size() > 1)
+            pool->ParallelFor(parts.size(), parseRange);
+        else
+            parseRange(0);
+
+        std::vector<JsonDocument> documents;
+        if (parts.size() == 1)
+            return std::move(parts[0]);
+        std::size_t total = 0;
+        for (const auto &part : parts)
+            total += part.size();
+        documents.reserve(total);
+        for (auto &part : parts)
+            std::move(part.begin(), part.end(), std::back_inserter(documents));
+        return documents;
+    }
+};
+
+inline FormatRegistration<FileParser> jsonFormat({"json"}, std::make_shared<JsonParser>());
+inline FormatRegistration<FileParser> jsonLinesFormat({"ndjson", "jsonl"}, std::make_shared<JsonParser>(true));
+
+class XmlParser : public FileParser
+{
+private:
+    // Thin wrapper over the event stream: re-emits the document as text.
+    static ParseResult Reemit(XmlReader &reader)
+    {
+        std::string out;
+        bool tagOpen = false; // "<name attr..." written, '>' still missing
+        while (reader.Next())
+        {
+            XmlEvent event = reader.Event();
+            if (tagOpen && event != XmlEvent::Attribute)
+            {
+                out += event == XmlEvent::EndElement ? "/>" : ">";
+                tagOpen = false;
+                if (event == XmlEvent::EndElement)
+                    continue;
+            }
+            switch (event)
+            {
+            case XmlEvent::StartElement:
+                out += '<';
+                out += reader.Name();
+                tagOpen = true;
+                break;
+            case XmlEvent::Attribute:
+                out += ' ';
+                out += reader.Name();
+                out += "=\"";
+                AppendXmlEscaped(out, reader.Value(), true);
+                out += '"';
+                break;
+            case XmlEvent::Text:
+                AppendXmlEscaped(out, reader.Value(), false);
+                break;
+            case XmlEvent::EndElement:
+                out += "</";
+                out += reader.Name();
+                out += '>';
+                break;
+            case XmlEvent::Comment:
+                out += "<!--";
+                out += reader.Value();
+                out += "-->";
+                break;
+            case XmlEvent::Instruction:
+                out += "<?";
+                out += reader.Name();
+                if (!reader.Value().empty())
+                    out += ' ';
+                out += reader.Value();
+                out += "?>";
+                break;
+            }
+        }
+        return ParseResult("Parsed XML File:\n", std::move(out));
+    }
+
+public:
+    // Streams the file in chunks instead of mapping it.
+    ParseResult parse(const std::string &FilePath) const override
+    {
+        XmlReader reader(FilePath);
+        return Reemit(reader);
+    }
+
+    ParseResult parseContent(std::shared_ptr<const MappedFile> file) const override
+    {
+        XmlReader reader(file->View(), XmlReader::DefaultChunkBytes);
+        return Reemit(reader);
+    }
+
+    // SAX-style entry point: onEvent(reader) is called for every event while
+    // the file is read in fixed-size chunks.
+    template <typename OnEvent>
+    void parseEvents(const std::string &FilePath, OnEvent &&onEvent,
+                     std::size_t chunkBytes = XmlReader::DefaultChunkBytes) const
+    {
+        XmlReader reader(FilePath, chunkBytes);
+        while (reader.Next())
+            onEvent(static_cast<const XmlReader &>(reader));
+    }
+};
+
+inline FormatRegistration<FileParser> xmlFormat({"xml"}, std::make_shared<XmlParser>());
+
+class CsvParser : public FileParser
+{
+public:
+    // Checks every record and emits the fields as written (borrowed from the
+    // mapping); parseTable gives the typed columns.
+    ParseResult parseContent(std::shared_ptr<const MappedFile> file) const override
+    {
+        std::string_view text = file->View();
+        CsvTable::Check(text, SharedParsePool());
+        return ParseResult("Parsed CSV File:\n", std::move(file), text);
+    }
+
+    // Columnar load; options.columns restricts it to the named columns.
+    // Large files are split at record boundaries and parsed on the pool.
+    CsvTable parseTable(const std::string &FilePath, const CsvOptions &options = CsvOptions(),
+                        WorkStealingPool *pool = &SharedParsePool()) const
+    {
+        auto file = MappedFile::Open(FilePath);
+        if (pool)
+            return CsvTable::ParseParallel(file->View(), *pool, options);
+        return CsvTable::Parse(file->View(), options);
+    }
+
+    // Data rows only, without splitting fields.
+    std::size_t countRows(const std::string &FilePath, const CsvOptions &options = CsvOptions()) const
+    {
+        auto file = MappedFile::Open(FilePath);
+        return CountCsvRows(file->View(), options);
+    }
+};
+
+inline FormatRegistration<FileParser> csvFormat({"csv"}, std::make_shared<CsvParser>());
+
+class YamlParser : public FileParser
+{
+public:
+    // Parses every document and re-emits it in block style, "---" between
+    // documents.
+    ParseResult parseContent(std::shared_ptr<const MappedFile> file) const override
+    {
+        std::string out;
+        YamlStream stream(file->View());
+        while (stream.Next())
+        {
+            if (stream.Documents() > 1)
+                out += "---\n";
+            AppendYaml(out, stream.Root());
+        }
+        return ParseResult("Parsed YAML File:\n", std::move(out));
+    }
+
+    // onDocument(root) for each document in turn; a root is only valid
+    // during its call (the node arena is reset for the next document).
+    template <typename OnDocument>
+    std::size_t parseDocuments(const std::string &FilePath, OnDocument &&onDocument) const
+    {
+        auto file = MappedFile::Open(FilePath);
+        YamlStream stream(file->View());
+        while (stream.Next())
+            onDocument(*stream.Root());
+        return stream.Documents();
+    }
+};
+
+inline FormatRegistration<FileParser> yamlFormat({"yaml", "yml"}, std::make_shared<YamlParser>());
+
+// Parsers are looked up in FormatRegistry<FileParser>::Global(), which each
+// format fills next to its class; the returned parsers are shared instances.
+class ParserFactory
+{
+public:
+    static const FileParser &createParser(const std::string &file_type);
+    static const FileParser &parserForFile(const std::string &FilePath);
+    static const FileParser &detectParser(const std::string &FilePath, std::string *format = nullptr);
+    static const FileParser &detectParser(const std::string &FilePath, std::string_view content,
+                                          std::string *format = nullptr);
+    static const FileParser *extensionFallback(const std::string &FilePath, std::string_view chosen);
+};
+
+inline const FileParser &ParserFactory::createParser(const std::string &file_type)
+{
+    const FileParser *parser = FormatRegistry<FileParser>::Global().Find(file_type);
+    if (!parser)
+        throw std::invalid_argument("Unsupported file type " + file_type);
+    return *parser;
+}
+
+// Matches compound extensions ("csv.gz") before simple ones ("gz").
+inline const FileParser &ParserFactory::parserForFile(const std::string &FilePath)
+{
+    const FileParser *parser = FormatRegistry<FileParser>::Global().FindForFile(FilePath);
+    if (!parser)
+        throw std::invalid_argument("Unsupported file type: " + FilePath);
+    return *parser;
+}
+
+// Sniffs the head of the file (see FormatSniffer.hpp); the extension is
+// only a hint, so files without one, or with a wrong one, still parse.
+// `format` receives the registry key that was chosen.
+inline const FileParser &ParserFactory::detectParser(const std::string &FilePath, std::string *format)
+{
+    char head[SniffBytes];
+    std::size_t length = ReadFileHead(FilePath, head, sizeof(head));
+    return detectParser(FilePath, std::string_view(head, length), format);
+}
+
+// Same, for a file whose content (or head) is already in memory.
+inline const FileParser &ParserFactory::detectParser(const std::string &FilePath, std::string_view content,
+                                                     std::string *format)
+{
+    const FormatRegistry<FileParser> &registry = FormatRegistry<FileParser>::Global();
+    std::string hint;
+    registry.FindForFile(FilePath, &hint);
+
+    FormatGuess guess = SniffContent(content.substr(0, SniffBytes), content.size() >= SniffBytes);
+    std::string_view chosen = ChooseFormat(guess, hint);
+    const FileParser *parser = chosen.empty() ? nullptr : registry.Find(chosen);
+    if (!parser)
+        throw std::invalid_argument("Unsupported file type: " + FilePath);
+    if (format)
+        format->assign(chosen);
+    return *parser;
+}
+
+// The parser the extension names when content sniffing chose another
+// format (`chosen`), to retry with if that one fails; null otherwise.
+inline const FileParser *ParserFactory::extensionFallback(const std::string &FilePath, std::string_view chosen)
+{
+    const FormatRegistry<FileParser> &registry = FormatRegistry<FileParser>::Global();
+    std::string hint;
+    const FileParser *named = registry.FindForFile(FilePath, &hint);
+    if (!named || named == registry.Find(chosen))
+        return nullptr;
+    return named;
+}
+
+// Utility Function to Extract File Extension; empty when the file name has
+// none (dots in directory names and a leading dot do not count).
+inline std::string getFileExtension(const std::string &fileName)
+{
+    size_t slashPos = fileName.find_last_of('/');
+    size_t nameStart = slashPos == std::string::npos ? 0 : slashPos + 1;
+    size_t dotPos = fileName.rfind('.');
+    if (dotPos == std::string::npos || dotPos <= nameStart)
+        return "";
+    return fileName.substr(dotPos + 1);
+}
+
+// A sniffed format that overrode the extension can still be wrong (a ".txt"
+// log starting with "[2026-..."); its parse error then falls back to the
+// parser the extension names.
+inline ParseResult ParseDetected(const std::string &FilePath)
+{
+    std::string format;
+    const FileParser &parser = ParserFactory::detectParser(FilePath, &format);
+    try
+    {
+        return parser.parse(FilePath);
+    }
+    catch (const std::runtime_error &)
+    {
+        const FileParser *fallback = ParserFactory::extensionFallback(FilePath, format);
+        if (!fallback)
+            throw;
+        return fallback->parse(FilePath);
+    }
+}
+
+inline ParseResult ParseLoaded(const std::string &FilePath, std::shared_ptr<const MappedFile> file)
+{
+    std::string format;
+    const FileParser &parser = ParserFactory::detectParser(FilePath, file->View(), &format);
+    try
+    {
+        return parser.parseContent(file);
+    }
+    catch (const std::runtime_error &)
+    {
+        const FileParser *fallback = ParserFactory::extensionFallback(FilePath, format);
+        if (!fallback)
+            throw;
+        return fallback->parseContent(std::move(file));
+    }
+}
+
+#endif
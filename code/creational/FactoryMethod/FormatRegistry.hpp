@@ -0,0 +1,243 @@
+#ifndef FORMAT_REGISTRY_HPP
+#define FORMAT_REGISTRY_HPP
+
+/*
+Extension -> handler registry with constant-time lookup, used by
+ParserFactory. Formats register themselves from their own translation unit:
+
+    static FormatRegistration<FileParser> csvFormat({"csv", "tsv"}, std::make_shared<CsvParser>());
+
+Every registration rebuilds a perfect hash over all extensions ("hash and
+displace"): keys are grouped into buckets by one hash, and each bucket gets
+the smallest seed that sends all of its keys to free slots of a table at
+most half full. A lookup is therefore two hashes and one string compare,
+whatever the number of formats. Extensions are matched case-insensitively.
+
+FindForFile tries the compound extensions of a file name longest first, so
+"data.csv.gz" finds a "csv.gz" handler before a "gz" one.
+
+Handlers are shared, immutable instances (the parsers are stateless), so a
+lookup never allocates. Tables replaced by a later registration are kept
+alive, so a lookup running concurrently with a registration stays valid.
+*/
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+template <typename Handler>
+class FormatRegistry
+{
+private:
+    static const std::size_t MaxExtensionLength = 32;
+
+    struct Entry
+    {
+        std::string extension; // lower case; empty marks a free slot
+        std::shared_ptr<const Handler> handler;
+    };
+
+    struct Table
+    {
+        std::vector<Entry> slots;
+        std::vector<std::uint32_t> seeds; // per bucket
+        std::size_t slotMask = 0;
+        std::size_t bucketMask = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;
+    std::atomic<const Table *> table{nullptr};
+    std::vector<std::unique_ptr<const Table>> tables; // current one last
+
+    static std::uint64_t Fnv1a(std::string_view key)
+    {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (char c : key)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static std::uint64_t Mix(std::uint64_t hash, std::uint64_t seed)
+    {
+        hash ^= seed * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // ASCII lower case into `out`; false if the key is too long to register.
+    static bool Lower(std::string_view key, char (&out)[MaxExtensionLength], std::size_t &length)
+    {
+        if (key.size() > MaxExtensionLength)
+            return false;
+        for (std::size_t i = 0; i < key.size(); i++)
+        {
+            char c = key[i];
+            out[i] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+        length = key.size();
+        return true;
+    }
+
+    static std::size_t PowerOfTwoAtLeast(std::size_t n)
+    {
+        std::size_t size = 1;
+        while (size < n)
+            size <<= 1;
+        return size;
+    }
+
+    std::unique_ptr<Table> Build() const
+    {
+        auto built = std::make_unique<Table>();
+        std::size_t slotCount = PowerOfTwoAtLeast(std::max<std::size_t>(8, entries.size() * 2));
+        std::size_t bucketCount = PowerOfTwoAtLeast(std::max<std::size_t>(1, entries.size() / 2));
+        built->slots.resize(slotCount);
+        built->seeds.assign(bucketCount, 0);
+        built->slotMask = slotCount - 1;
+        built->bucketMask = bucketCount - 1;
+
+        std::vector<std::vector<std::size_t>> buckets(bucketCount);
+        std::vector<std::uint64_t> hashes(entries.size());
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            hashes[i] = Fnv1a(entries[i].extension);
+            buckets[Mix(hashes[i], 0) & built->bucketMask].push_back(i);
+        }
+        std::vector<std::size_t> order(bucketCount);
+        for (std::size_t b = 0; b < bucketCount; b++)
+            order[b] = b;
+        std::sort(order.begin(), order.end(),
+                  [&](std::size_t x, std::size_t y) { return buckets[x].size() > buckets[y].size(); });
+
+        // Largest buckets first, while the table is emptiest.
+        std::vector<std::size_t> placed;
+        for (std::size_t b : order)
+        {
+            if (buckets[b].empty())
+                break;
+            for (std::uint32_t seed = 1;; seed++)
+            {
+                placed.clear();
+                bool fits = true;
+                for (std::size_t i : buckets[b])
+                {
+                    std::size_t slot = Mix(hashes[i], seed) & built->slotMask;
+                    if (!built->slots[slot].extension.empty() ||
+                        std::find(placed.begin(), placed.end(), slot) != placed.end())
+                    {
+                        fits = false;
+                        break;
+                    }
+                    placed.push_back(slot);
+                }
+                if (!fits)
+                    continue;
+                for (std::size_t k = 0; k < placed.size(); k++)
+                    built->slots[placed[k]] = entries[buckets[b][k]];
+                built->seeds[b] = seed;
+                break;
+            }
+        }
+        return built;
+    }
+
+public:
+    // The process-wide registry that FormatRegistration fills.
+    static FormatRegistry &Global()
+    {
+        static FormatRegistry registry;
+        return registry;
+    }
+
+    // Makes `handler` responsible for every extension in the list; a later
+    // registration of the same extension replaces the earlier one.
+    void Register(std::initializer_list<std::string_view> extensions, std::shared_ptr<const Handler> handler)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::string_view extension : extensions)
+        {
+            char lowered[MaxExtensionLength];
+            std::size_t length = 0;
+            if (extension.empty() || !Lower(extension, lowered, length))
+                throw std::invalid_argument("Cannot register file extension: " + std::string(extension));
+            std::string key(lowered, length);
+            auto existing = std::find_if(entries.begin(), entries.end(),
+                                         [&](const Entry &entry) { return entry.extension == key; });
+            if (existing != entries.end())
+                existing->handler = handler;
+            else
+                entries.push_back(Entry{key, handler});
+        }
+        tables.push_back(Build());
+        table.store(tables.back().get(), std::memory_order_release);
+    }
+
+    // Handler for one extension (without the dot), or nullptr.
+    const Handler *Find(std::string_view extension) const
+    {
+        const Table *current = table.load(std::memory_order_acquire);
+        char lowered[MaxExtensionLength];
+        std::size_t length = 0;
+        if (!current || !Lower(extension, lowered, length))
+            return nullptr;
+        std::string_view key(lowered, length);
+        std::uint64_t hash = Fnv1a(key);
+        std::uint32_t seed = current->seeds[Mix(hash, 0) & current->bucketMask];
+        const Entry &entry = current->slots[Mix(hash, seed) & current->slotMask];
+        return entry.extension == key ? entry.handler.get() : nullptr;
+    }
+
+    // Handler for a file name, trying its compound extensions longest first.
+    // `matched` receives the extension that was found.
+    const Handler *FindForFile(std::string_view path, std::string *matched = nullptr) const
+    {
+        std::size_t slash = path.find_last_of('/');
+        std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+        std::size_t dot = name.find('.', 1); // a leading dot is a hidden file, not an extension
+        while (dot != std::string_view::npos)
+        {
+            std::string_view extension = name.substr(dot + 1);
+            if (const Handler *handler = Find(extension))
+            {
+                if (matched)
+                    matched->assign(extension);
+                return handler;
+            }
+            dot = name.find('.', dot + 1);
+        }
+        return nullptr;
+    }
+
+    std::size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+};
+
+// A namespace-scope `static FormatRegistration<H> name({...}, handler);`
+// registers a format with FormatRegistry<H>::Global() before main() runs.
+template <typename Handler>
+struct FormatRegistration
+{
+    FormatRegistration(std::initializer_list<std::string_view> extensions, std::shared_ptr<const Handler> handler)
+    {
+        FormatRegistry<Handler>::Global().Register(extensions, std::move(handler));
+    }
+};
+
+#endif
@@ -0,0 +1,414 @@
+#ifndef FORMAT_SNIFFER_HPP
+#define FORMAT_SNIFFER_HPP
+
+/*
+Content-based format detection. Only the head of a file (SniffBytes) is read,
+with one pread into a stack buffer, so detecting the format of every file in
+a batch costs one extra open and read of a page.
+
+SniffContent looks at, in order:
+  - a byte order mark (UTF-8 is skipped; UTF-16/32 is reported as text),
+  - NUL bytes, which mean binary (no guess),
+  - the first significant character: '<' is XML when the head has an XML
+    declaration, doctype or comment, or the end of its first element; '{' or
+    '[' is JSON when the head validates as JSON up to where it is cut off, or
+    JSON Lines when it holds several values on their own lines,
+  - "%YAML" or a "---" document marker,
+  - the first complete lines of the head (at most SniffLineLimit):
+    "key:" / "- item" lines are YAML, the same non-zero number of unquoted
+    commas on every record is CSV, anything else is text.
+
+The markers are Strong guesses; the line statistics are Weak. ChooseFormat
+lets a Strong guess override the extension, and otherwise treats the
+extension as the answer when there is one. A file whose content overrode its
+extension and then fails to parse is retried with the extension's parser
+(see ParseDetected in FileParsers.hpp). All guesses are registry keys of
+FormatRegistry<FileParser> ("txt", "json", "ndjson", "xml", "csv", "yaml").
+*/
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+
+enum class SniffConfidence
+{
+    None,
+    Weak,
+    Strong
+};
+
+struct FormatGuess
+{
+    std::string_view format; // registry key; empty when there is no guess
+    SniffConfidence confidence = SniffConfidence::None;
+};
+
+static const std::size_t SniffBytes = 4096;
+
+// Reads up to `capacity` bytes from the start of the file; the count read.
+inline std::size_t ReadFileHead(const std::string &FilePath, char *buffer, std::size_t capacity)
+{
+    int fd = ::open(FilePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open file: " + FilePath);
+    std::size_t filled = 0;
+    while (filled < capacity)
+    {
+        ssize_t got = ::pread(fd, buffer + filled, capacity - filled, static_cast<off_t>(filled));
+        if (got <= 0)
+            break;
+        filled += static_cast<std::size_t>(got);
+    }
+    ::close(fd);
+    return filled;
+}
+
+namespace sniff_detail
+{
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+inline std::string_view Trim(std::string_view line)
+{
+    while (!line.empty() && IsSpace(line.front()))
+        line.remove_prefix(1);
+    while (!line.empty() && IsSpace(line.back()))
+        line.remove_suffix(1);
+    return line;
+}
+
+// "key:" followed by a space or the end of the line, or a "- " sequence item.
+inline bool IsYamlLine(std::string_view line)
+{
+    std::size_t i = 0;
+    while (i < line.size() && line[i] == ' ')
+        i++;
+    if (i < line.size() && line[i] == '-')
+        return i + 1 == line.size() || line[i + 1] == ' ';
+    std::size_t keyStart = i;
+    while (i < line.size() && line[i] != ':')
+    {
+        char c = line[i];
+        bool keyChar = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+                       c == '-' || c == '.' || c == ' ';
+        if (!keyChar)
+            return false;
+        i++;
+    }
+    return i > keyStart && i < line.size() && (i + 1 == line.size() || line[i + 1] == ' ');
+}
+
+// Result of checking the head as JSON text: whether it is valid up to where
+// it stops, and how many top-level values it holds, each starting on a new
+// line after the first (JSON Lines).
+struct JsonHeadCheck
+{
+    bool valid = false;
+    std::size_t values = 0;
+};
+
+// Validates `text` (starting at '{' or '[') against the JSON grammar. A head
+// cut off mid-value is valid when `truncated`; text after a complete value
+// must be whitespace or further values on their own lines.
+inline JsonHeadCheck CheckJsonHead(std::string_view text, bool truncated)
+{
+    JsonHeadCheck result;
+    char stack[64]; // open containers; deeper heads are accepted as they are
+    std::size_t depth = 0;
+    enum class Expect
+    {
+        Value,        // any value
+        FirstValue,   // a value or ']' right after '['
+        Key,          // a string key
+        FirstKey,     // a key or '}' right after '{'
+        Colon,
+        CommaOrClose,
+        NextValue     // top level: a new value on a new line
+    } expect = Expect::Value;
+    bool newline = true;
+
+    std::size_t i = 0;
+    auto cutOff = [&]() { return truncated && i >= text.size(); };
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (IsSpace(c))
+        {
+            newline = newline || c == '\n';
+            i++;
+            continue;
+        }
+        if (expect == Expect::NextValue)
+        {
+            if (!newline || (c != '{' && c != '['))
+                return result;
+            expect = Expect::Value;
+        }
+        newline = false;
+
+        bool valueStart = expect == Expect::Value || expect == Expect::FirstValue;
+        bool keyStart = expect == Expect::Key || expect == Expect::FirstKey;
+        if ((c == '}' && (expect == Expect::FirstKey || expect == Expect::CommaOrClose)) ||
+            (c == ']' && (expect == Expect::FirstValue || expect == Expect::CommaOrClose)))
+        {
+            if (depth == 0 || (depth <= sizeof(stack) && stack[depth - 1] != (c == '}' ? '{' : '[')))
+                return result;
+            depth--;
+            i++;
+        }
+        else if (c == ',' && expect == Expect::CommaOrClose && depth > 0)
+        {
+            expect = depth <= sizeof(stack) && stack[depth - 1] == '{' ? Expect::Key : Expect::Value;
+            i++;
+            continue;
+        }
+        else if (c == ':' && expect == Expect::Colon)
+        {
+            expect = Expect::Value;
+            i++;
+            continue;
+        }
+        else if ((c == '{' || c == '[') && valueStart)
+        {
+            if (depth < sizeof(stack))
+                stack[depth] = c;
+            depth++;
+            expect = c == '{' ? Expect::FirstKey : Expect::FirstValue;
+            i++;
+            continue;
+        }
+        else if (c == '"' && (valueStart || keyStart))
+        {
+            for (i++; i < text.size() && text[i] != '"'; i++)
+            {
+                if (static_cast<unsigned char>(text[i]) < 0x20)
+                    return result;
+                if (text[i] == '\\')
+                    i++;
+            }
+            if (i >= text.size())
+            {
+                result.valid = truncated;
+                return result;
+            }
+            i++;
+            if (keyStart)
+            {
+                expect = Expect::Colon;
+                continue;
+            }
+        }
+        else if ((c == '-' || (c >= '0' && c <= '9')) && valueStart)
+        {
+            // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+            auto digits = [&]()
+            {
+                std::size_t start = i;
+                while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+                    i++;
+                return i - start;
+            };
+            if (c == '-')
+                i++;
+            std::size_t first = i;
+            std::size_t integer = digits();
+            if ((integer == 0 && !cutOff()) || (integer > 1 && text[first] == '0'))
+                return result;
+            if (i < text.size() && text[i] == '.')
+            {
+                i++;
+                if (digits() == 0 && !cutOff())
+                    return result;
+            }
+            if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+            {
+                i++;
+                if (i < text.size() && (text[i] == '+' || text[i] == '-'))
+                    i++;
+                if (digits() == 0 && !cutOff())
+                    return result;
+            }
+        }
+        else if ((c == 't' || c == 'f' || c == 'n') && valueStart)
+        {
+            std::string_view word = c == 't' ? "true" : c == 'f' ? "false" : "null";
+            std::string_view have = text.substr(i, word.size());
+            if (have != word.substr(0, have.size()) || (have.size() < word.size() && !truncated))
+                return result;
+            i += have.size();
+        }
+        else
+        {
+            return result;
+        }
+
+        // A value (or a container) just ended.
+        if (depth == 0)
+        {
+            result.values++;
+            expect = Expect::NextValue;
+        }
+        else
+        {
+            expect = Expect::CommaOrClose;
+        }
+    }
+    result.valid = expect == Expect::NextValue || truncated;
+    return result;
+}
+
+// Lines past this add cost but hardly ever change the verdict.
+static const std::size_t SniffLineLimit = 32;
+
+// Statistics over the first complete lines of the head.
+inline FormatGuess SniffLines(std::string_view text)
+{
+    std::size_t lines = 0;
+    bool yaml = true;
+    bool topLevelKey = false;
+
+    std::size_t records = 0;
+    std::size_t commas = 0;
+    std::size_t recordCommas = 0;
+    bool csv = true;
+    bool inQuote = false;
+
+    std::size_t start = 0;
+    while (start < text.size())
+    {
+        std::size_t end = text.find('\n', start);
+        if (end == std::string_view::npos)
+            end = text.size();
+        std::string_view line = text.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        start = end + 1;
+
+        if (csv && !inQuote && line.find('"') == std::string_view::npos)
+        {
+            commas += static_cast<std::size_t>(std::count(line.begin(), line.end(), ','));
+        }
+        else if (csv)
+        {
+            for (char c : line)
+            {
+                if (c == '"')
+                    inQuote = !inQuote;
+                else if (c == ',' && !inQuote)
+                    commas++;
+            }
+        }
+        if (!inQuote && !Trim(line).empty())
+        {
+            if (records == 0)
+                recordCommas = commas;
+            else if (commas != recordCommas)
+                csv = false;
+            records++;
+            commas = 0;
+        }
+
+        std::string_view content = Trim(line);
+        if (content.empty() || content.front() == '#')
+            continue;
+        lines++;
+        if (yaml && !IsYamlLine(line))
+            yaml = false;
+        else if (yaml && line.front() != ' ' && line.front() != '-')
+            topLevelKey = true;
+        if ((!yaml && !csv) || lines == SniffLineLimit)
+            break;
+    }
+
+    if (lines >= 2 && yaml && topLevelKey)
+        return {"yaml", SniffConfidence::Weak};
+    if (records >= 2 && csv && recordCommas > 0)
+        return {"csv", SniffConfidence::Weak};
+    return {"txt", SniffConfidence::Weak};
+}
+} // namespace sniff_detail
+
+// Guesses the format of a file from its first bytes. `truncated` says that
+// `head` stops before the end of the file, so its last line is partial.
+inline FormatGuess SniffContent(std::string_view head, bool truncated)
+{
+    using namespace sniff_detail;
+    if (head.size() >= 3 && head.substr(0, 3) == "\xEF\xBB\xBF")
+        head.remove_prefix(3);
+    else if (head.size() >= 2 && (head.substr(0, 2) == "\xFF\xFE" || head.substr(0, 2) == "\xFE\xFF"))
+        return {"txt", SniffConfidence::Weak}; // UTF-16/32: none of the parsers decodes it
+    if (head.find('\0') != std::string_view::npos)
+        return {};
+
+    std::size_t first = 0;
+    while (first < head.size() && IsSpace(head[first]))
+        first++;
+    if (first == head.size())
+        return {};
+    std::string_view text = head.substr(first);
+
+    char lead = text.front();
+    if (lead == '<')
+    {
+        // Strong only for a declaration, doctype or comment, or a first
+        // element that is closed in the head (or, in a longer file, a head
+        // that closes some element); "<b>not xml" stays text.
+        if (text.substr(0, 5) == "<?xml" || text.substr(0, 9) == "<!DOCTYPE" || text.substr(0, 4) == "<!--")
+            return {"xml", SniffConfidence::Strong};
+        std::size_t nameEnd = 1;
+        while (nameEnd < text.size() && !IsSpace(text[nameEnd]) && text[nameEnd] != '>' && text[nameEnd] != '/')
+            nameEnd++;
+        std::string_view name = text.substr(1, nameEnd - 1);
+        char first = name.empty() ? '\0' : name.front();
+        bool elementName = first == '_' || (first >= 'a' && first <= 'z') || (first >= 'A' && first <= 'Z');
+        if (elementName)
+        {
+            std::string endTag = "</" + std::string(name);
+            std::size_t tagEnd = text.find('>');
+            bool selfClosed = tagEnd != std::string_view::npos && tagEnd > 0 && text[tagEnd - 1] == '/';
+            bool closed = text.find(endTag) != std::string_view::npos ||
+                          (truncated && text.find("</") != std::string_view::npos);
+            return {"xml", selfClosed || closed ? SniffConfidence::Strong : SniffConfidence::Weak};
+        }
+    }
+    if (lead == '{' || lead == '[')
+    {
+        // Strong only when the head is valid JSON so far: "[2026-10-18 ...]"
+        // log lines and "{braces}" prose are text.
+        JsonHeadCheck check = CheckJsonHead(text, truncated);
+        if (check.valid)
+            return {check.values > 1 ? "ndjson" : "json", SniffConfidence::Strong};
+    }
+    if (text.substr(0, 5) == "%YAML" ||
+        (text.substr(0, 3) == "---" && (text.size() == 3 || IsSpace(text[3]))))
+        return {"yaml", SniffConfidence::Strong};
+
+    if (truncated)
+    {
+        std::size_t lastNewline = text.rfind('\n');
+        text = lastNewline == std::string_view::npos ? std::string_view() : text.substr(0, lastNewline + 1);
+        if (text.empty())
+            return {"txt", SniffConfidence::Weak}; // one line longer than the head
+    }
+    return SniffLines(text);
+}
+
+// The format to parse a file as: a Strong content guess wins over the
+// extension hint (except JSON in a file named as JSON Lines, a one-record
+// stream), a Weak one only decides when there is no hint.
+inline std::string_view ChooseFormat(const FormatGuess &guess, std::string_view hint)
+{
+    if (guess.confidence == SniffConfidence::Strong)
+    {
+        std::string lowered(hint);
+        for (char &c : lowered)
+            c = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        bool linesHint = lowered == "ndjson" || lowered == "jsonl";
+        return guess.format == "json" && linesHint ? hint : guess.format;
+    }
+    return hint.empty() ? guess.format : hint;
+}
+
+#endif
@@ -0,0 +1,948 @@
+#ifndef JSON_DOCUMENT_HPP
+#define JSON_DOCUMENT_HPP
+
+/*
+JSON parser used by JsonParser, in two stages:
+
+1. Structural scan. The input is classified 64 bytes at a time into bitmasks
+   (quotes, backslashes, operators {}[]:, and whitespace) by a SIMD kernel
+   picked at runtime: AVX2, SSE2 or a scalar fallback. Bit tricks on the
+   masks then drop escaped quotes, mask out string contents and yield the
+   positions of every structural character and the start of every scalar.
+
+2. Tape building. A loop over those positions validates the grammar and
+   writes the document to a "tape": one contiguous array of 64-bit words,
+   with string contents in a second contiguous buffer. No per-node
+   allocation happens.
+
+Tape words keep the type in the top 8 bits and a payload in the low 56:
+    '{' / '['  payload = tape index just past the matching '}' / ']'
+    '}' / ']'  payload = tape index of the matching '{' / '['
+    '"'        payload = offset into the string buffer (uint32 length + bytes)
+    'l' / 'd'  followed by one word holding the int64 / double bits
+    't' 'f' 'n'  true, false, null
+*/
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JSON_HAVE_X86 1
+#endif
+
+enum class JsonKernel : unsigned char
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+inline const char *JsonKernelName(JsonKernel kernel)
+{
+    switch (kernel)
+    {
+    case JsonKernel::Scalar:
+        return "scalar";
+    case JsonKernel::Sse2:
+        return "sse2";
+    case JsonKernel::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+// Widest kernel the running CPU supports.
+inline JsonKernel BestJsonKernel()
+{
+    static const JsonKernel best = []()
+    {
+#ifdef JSON_HAVE_X86
+        if (__builtin_cpu_supports("avx2"))
+            return JsonKernel::Avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return JsonKernel::Sse2;
+#endif
+        return JsonKernel::Scalar;
+    }();
+    return best;
+}
+
+// Character classes of one 64 byte block, bit i = byte i.
+struct JsonBlockMasks
+{
+    std::uint64_t quote;
+    std::uint64_t backslash;
+    std::uint64_t op; // { } [ ] : ,
+    std::uint64_t space;
+};
+
+inline void ClassifyBlocksScalar(const char *data, std::size_t blocks, JsonBlockMasks *out)
+{
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+        JsonBlockMasks masks{0, 0, 0, 0};
+        const char *block = data + b * 64;
+        for (int i = 0; i < 64; i++)
+        {
+            std::uint64_t bit = std::uint64_t(1) << i;
+            switch (block[i])
+            {
+            case '"':
+                masks.quote |= bit;
+                break;
+            case '\\':
+                masks.backslash |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                masks.op |= bit;
+                break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                masks.space |= bit;
+                break;
+            default:
+                break;
+            }
+        }
+        out[b] = masks;
+    }
+}
+
+#ifdef JSON_HAVE_X86
+__attribute__((target("sse2"))) inline void ClassifyBlocksSse2(const char *data, std::size_t blocks, JsonBlockMasks *out)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i lowerBit = _mm_set1_epi8(0x20); // '[' | 0x20 == '{', ']' | 0x20 == '}'
+    const __m128i blank = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+        JsonBlockMasks masks{0, 0, 0, 0};
+        for (int part = 0; part < 4; part++)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + b * 64 + part * 16));
+            __m128i folded = _mm_or_si128(chunk, lowerBit);
+            __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma)));
+            __m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, blank), _mm_cmpeq_epi8(chunk, tab)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage)));
+            int shift = part * 16;
+            masks.quote |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)))) << shift;
+            masks.backslash |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)))) << shift;
+            masks.op |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(op))) << shift;
+            masks.space |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(space))) << shift;
+        }
+        out[b] = masks;
+    }
+}
+
+__attribute__((target("avx2"))) inline void ClassifyBlocksAvx2(const char *data, std::size_t blocks, JsonBlockMasks *out)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i openBrace = _mm256_set1_epi8('{');
+    const __m256i closeBrace = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i lowerBit = _mm256_set1_epi8(0x20);
+    const __m256i blank = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+        JsonBlockMasks masks{0, 0, 0, 0};
+        for (int part = 0; part < 2; part++)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + b * 64 + part * 32));
+            __m256i folded = _mm256_or_si256(chunk, lowerBit);
+            __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, openBrace), _mm256_cmpeq_epi8(folded, closeBrace)),
+                                         _mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, comma)));
+            __m256i space = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, blank), _mm256_cmpeq_epi8(chunk, tab)),
+                                            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, carriage)));
+            int shift = part * 32;
+            masks.quote |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)))) << shift;
+            masks.backslash |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)))) << shift;
+            masks.op |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(op))) << shift;
+            masks.space |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(space))) << shift;
+        }
+        out[b] = masks;
+    }
+}
+#endif
+
+inline void ClassifyBlocks(JsonKernel kernel, const char *data, std::size_t blocks, JsonBlockMasks *out)
+{
+#ifdef JSON_HAVE_X86
+    if (kernel == JsonKernel::Avx2)
+        return ClassifyBlocksAvx2(data, blocks, out);
+    if (kernel == JsonKernel::Sse2)
+        return ClassifyBlocksSse2(data, blocks, out);
+#endif
+    (void)kernel;
+    ClassifyBlocksScalar(data, blocks, out);
+}
+
+// Bit i of the result is the xor of bits 0..i of x: turns quote positions
+// into an "inside a string" mask.
+inline std::uint64_t PrefixXor(std::uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Stage 1: offsets of every structural character, opening quote and scalar
+// start outside of strings, in input order.
+inline std::vector<std::size_t> FindJsonStructurals(std::string_view text, JsonKernel kernel = BestJsonKernel())
+{
+    const std::size_t ChunkBlocks = 1024; // 64 KiB of input per kernel call
+    std::vector<std::size_t> indices(text.size() / 4 + 64);
+    std::size_t found = 0;
+
+    std::vector<JsonBlockMasks> masks(std::min(ChunkBlocks, (text.size() + 63) / 64));
+    char tail[64];
+
+    std::uint64_t escapedCarry = 0;   // first byte of the next block is escaped
+    std::uint64_t inStringCarry = 0;  // all ones if the previous block ended inside a string
+    std::uint64_t scalarCarry = 0;    // previous block ended in a scalar character
+
+    std::size_t fullBlocks = text.size() / 64;
+    std::size_t totalBlocks = (text.size() + 63) / 64;
+    for (std::size_t first = 0; first < totalBlocks; first += ChunkBlocks)
+    {
+        std::size_t count = std::min(ChunkBlocks, totalBlocks - first);
+        std::size_t full = first < fullBlocks ? std::min(count, fullBlocks - first) : 0;
+        ClassifyBlocks(kernel, text.data() + first * 64, full, masks.data());
+        if (full < count)
+        {
+            // Last partial block: classify a space padded copy.
+            std::size_t rest = text.size() - fullBlocks * 64;
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, text.data() + fullBlocks * 64, rest);
+            ClassifyBlocks(kernel, tail, 1, masks.data() + full);
+        }
+
+        for (std::size_t b = 0; b < count; b++)
+        {
+            const JsonBlockMasks &m = masks[b];
+
+            // Escaped characters: each backslash that is not itself escaped
+            // escapes the next byte. Blocks without backslashes skip the loop.
+            std::uint64_t escaped = escapedCarry;
+            escapedCarry = 0;
+            std::uint64_t backslashes = m.backslash;
+            while (backslashes)
+            {
+                int i = __builtin_ctzll(backslashes);
+                backslashes &= backslashes - 1;
+                if ((escaped >> i) & 1)
+                    continue;
+                if (i == 63)
+                    escapedCarry = 1;
+                else
+                    escaped |= std::uint64_t(1) << (i + 1);
+            }
+
+            std::uint64_t quotes = m.quote & ~escaped;
+            std::uint64_t inString = PrefixXor(quotes) ^ inStringCarry;
+            inStringCarry = static_cast<std::uint64_t>(static_cast<std::int64_t>(inString) >> 63);
+
+            std::uint64_t openQuotes = quotes & inString;
+            std::uint64_t outside = ~inString & ~quotes;
+            std::uint64_t scalar = outside & ~(m.op | m.space);
+            std::uint64_t scalarStarts = scalar & ~((scalar << 1) | scalarCarry);
+            scalarCarry = scalar >> 63;
+
+            std::uint64_t structurals = (m.op & outside) | scalarStarts | openQuotes;
+            std::size_t base = (first + b) * 64;
+            if (text.size() - base < 64)
+                structurals &= (std::uint64_t(1) << (text.size() - base)) - 1; // drop the padding
+
+            // At most 64 new entries per block: grow once, then write without checks.
+            if (indices.size() - found < 64)
+                indices.resize(indices.size() * 2);
+            std::size_t *out = indices.data() + found;
+            while (structurals)
+            {
+                *out++ = base + static_cast<std::size_t>(__builtin_ctzll(structurals));
+                structurals &= structurals - 1;
+            }
+            found = static_cast<std::size_t>(out - indices.data());
+        }
+    }
+
+    if (inStringCarry)
+        throw std::runtime_error("Invalid JSON: unterminated string");
+    indices.resize(found);
+    return indices;
+}
+
+enum class JsonType : char
+{
+    Object = '{',
+    Array = '[',
+    String = '"',
+    Int64 = 'l',
+    Double = 'd',
+    True = 't',
+    False = 'f',
+    Null = 'n'
+};
+
+class JsonDocument;
+
+// Read-only cursor into a JsonDocument's tape.
+class JsonValue
+{
+private:
+    const JsonDocument *document;
+    std::size_t index;
+
+public:
+    JsonValue(const JsonDocument *document, std::size_t index) : document(document), index(index) {}
+
+    JsonType Type() const;
+    std::size_t TapeIndex() const { return index; }
+    std::size_t NextIndex() const; // tape index of the following sibling
+
+    bool IsNull() const { return Type() == JsonType::Null; }
+    bool AsBool() const;
+    std::int64_t AsInt64() const;
+    double AsDouble() const; // also accepts Int64
+    std::string_view AsString() const;
+
+    std::size_t Size() const;                     // elements of an array or members of an object
+    JsonValue operator[](std::size_t i) const;    // array element
+    JsonValue operator[](std::string_view key) const; // object member; throws if missing
+    bool Contains(std::string_view key) const;
+};
+
+class JsonDocument
+{
+private:
+    std::vector<std::uint64_t> tape;
+    std::string strings;
+
+    friend class JsonValue;
+
+    static std::uint64_t Word(char type, std::uint64_t payload)
+    {
+        return (static_cast<std::uint64_t>(static_cast<unsigned char>(type)) << 56) | payload;
+    }
+    static void Fail(std::size_t offset, const char *what)
+    {
+        throw std::runtime_error("Invalid JSON at offset " + std::to_string(offset) + ": " + what);
+    }
+    static bool IsTerminator(std::string_view text, std::size_t pos)
+    {
+        if (pos >= text.size())
+            return true;
+        switch (text[pos])
+        {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case ',':
+        case ']':
+        case '}':
+        case ':':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void ParseString(std::string_view text, std::size_t pos);
+    void ParseNumber(std::string_view text, std::size_t pos);
+    void ParseAtom(std::string_view text, std::size_t pos);
+    void ParseValueAt(std::string_view text, std::size_t pos);
+    void SerializeValue(std::string &out, std::size_t &i, bool pretty, int indent, int depth) const;
+
+public:
+    static const std::size_t MaxDepth = 1024;
+
+    static JsonDocument Parse(std::string_view text, JsonKernel kernel = BestJsonKernel());
+
+    JsonValue Root() const { return JsonValue(this, 0); }
+    std::size_t TapeSize() const { return tape.size(); }
+
+    // Re-encodes the document, compact or indented with `indent` spaces.
+    std::string Serialize(bool pretty = true, int indent = 4) const;
+};
+
+inline void AppendUtf8(std::string &out, std::uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        out += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800)
+    {
+        out += static_cast<char>(0xc0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    }
+    else if (codePoint < 0x10000)
+    {
+        out += static_cast<char>(0xe0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char>(0xf0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    }
+}
+
+inline int HexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Unescapes the string whose opening quote is at `pos` into the string buffer.
+inline void JsonDocument::ParseString(std::string_view text, std::size_t pos)
+{
+    std::size_t lengthAt = strings.size();
+    tape.push_back(Word('"', lengthAt));
+    strings.append(sizeof(std::uint32_t), '\0');
+
+    std::size_t i = pos + 1;
+    for (;;)
+    {
+        // Copy the plain run up to the next quote, backslash or control character.
+        std::size_t start = i;
+        while (i < text.size() && text[i] != '"' && text[i] != '\\' && static_cast<unsigned char>(text[i]) >= 0x20)
+            i++;
+        strings.append(text.data() + start, i - start);
+        if (i >= text.size())
+            Fail(pos, "unterminated string");
+        if (text[i] == '"')
+            break;
+        if (text[i] != '\\')
+            Fail(i, "control character in string");
+
+        if (++i >= text.size())
+            Fail(pos, "unterminated string");
+        switch (text[i++])
+        {
+        case '"':
+            strings += '"';
+            break;
+        case '\\':
+            strings += '\\';
+            break;
+        case '/':
+            strings += '/';
+            break;
+        case 'b':
+            strings += '\b';
+            break;
+        case 'f':
+            strings += '\f';
+            break;
+        case 'n':
+            strings += '\n';
+            break;
+        case 'r':
+            strings += '\r';
+            break;
+        case 't':
+            strings += '\t';
+            break;
+        case 'u':
+        {
+            auto readHex = [&](std::size_t at) -> std::uint32_t
+            {
+                if (at + 4 > text.size())
+                    Fail(at, "truncated \\u escape");
+                std::uint32_t value = 0;
+                for (std::size_t k = 0; k < 4; k++)
+                {
+                    int digit = HexValue(text[at + k]);
+                    if (digit < 0)
+                        Fail(at + k, "invalid \\u escape");
+                    value = value * 16 + static_cast<std::uint32_t>(digit);
+                }
+                return value;
+            };
+            std::uint32_t codePoint = readHex(i);
+            i += 4;
+            if (codePoint >= 0xd800 && codePoint <= 0xdbff)
+            {
+                if (i + 6 > text.size() || text[i] != '\\' || text[i + 1] != 'u')
+                    Fail(i, "unpaired surrogate");
+                std::uint32_t low = readHex(i + 2);
+                if (low < 0xdc00 || low > 0xdfff)
+                    Fail(i, "invalid low surrogate");
+                codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                i += 6;
+            }
+            else if (codePoint >= 0xdc00 && codePoint <= 0xdfff)
+            {
+                Fail(i, "unpaired surrogate");
+            }
+            AppendUtf8(strings, codePoint);
+            break;
+        }
+        default:
+            Fail(i - 1, "invalid escape");
+        }
+    }
+
+    std::uint32_t length = static_cast<std::uint32_t>(strings.size() - lengthAt - sizeof(std::uint32_t));
+    std::memcpy(&strings[lengthAt], &length, sizeof(length));
+}
+
+inline void JsonDocument::ParseNumber(std::string_view text, std::size_t pos)
+{
+    std::size_t i = pos;
+    auto digits = [&]()
+    {
+        std::size_t start = i;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+            i++;
+        return i - start;
+    };
+
+    if (i < text.size() && text[i] == '-')
+        i++;
+    std::size_t intStart = i;
+    std::size_t intDigits = digits();
+    if (intDigits == 0 || (intDigits > 1 && text[intStart] == '0'))
+        Fail(pos, "invalid number");
+    bool integral = true;
+    if (i < text.size() && text[i] == '.')
+    {
+        i++;
+        integral = false;
+        if (digits() == 0)
+            Fail(pos, "invalid number");
+    }
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+    {
+        i++;
+        integral = false;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-'))
+            i++;
+        if (digits() == 0)
+            Fail(pos, "invalid number");
+    }
+    if (!IsTerminator(text, i))
+        Fail(pos, "invalid number");
+
+    const char *first = text.data() + pos;
+    const char *last = text.data() + i;
+    if (integral)
+    {
+        std::int64_t value;
+        auto result = std::from_chars(first, last, value);
+        if (result.ec == std::errc() && result.ptr == last)
+        {
+            tape.push_back(Word('l', 0));
+            tape.push_back(static_cast<std::uint64_t>(value));
+            return;
+        }
+        // Out of int64 range: fall through to double.
+    }
+    double value;
+    auto result = std::from_chars(first, last, value);
+    if (result.ec != std::errc() || result.ptr != last)
+        Fail(pos, "number out of range");
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    tape.push_back(Word('d', 0));
+    tape.push_back(bits);
+}
+
+inline void JsonDocument::ParseAtom(std::string_view text, std::size_t pos)
+{
+    auto matches = [&](const char *word, std::size_t length)
+    {
+        return text.compare(pos, length, word) == 0 && IsTerminator(text, pos + length);
+    };
+    if (matches("true", 4))
+        tape.push_back(Word('t', 0));
+    else if (matches("false", 5))
+        tape.push_back(Word('f', 0));
+    else if (matches("null", 4))
+        tape.push_back(Word('n', 0));
+    else
+        Fail(pos, "unexpected character");
+}
+
+inline void JsonDocument::ParseValueAt(std::string_view text, std::size_t pos)
+{
+    char c = text[pos];
+    if (c == '"')
+        ParseString(text, pos);
+    else if (c == '-' || (c >= '0' && c <= '9'))
+        ParseNumber(text, pos);
+    else
+        ParseAtom(text, pos);
+}
+
+// Stage 2: walks the structural positions with an explicit stack of open
+// containers, validating the grammar while it appends to the tape.
+inline JsonDocument JsonDocument::Parse(std::string_view text, JsonKernel kernel)
+{
+    if (text.substr(0, 3) == "\xEF\xBB\xBF")
+        text.remove_prefix(3); // UTF-8 byte order mark
+    std::vector<std::size_t> indices = FindJsonStructurals(text, kernel);
+
+    JsonDocument document;
+    document.tape.reserve(indices.size() + 2);
+    document.strings.reserve(text.size() / 4);
+
+    enum class Expect : unsigned char
+    {
+        Value,        // a value (root, after ':' or after ',' in an array)
+        ValueOrClose, // first element of an array: a value or ']'
+        KeyOrClose,   // first member of an object: a key or '}'
+        Key,          // after ',' in an object
+        Colon,
+        CommaOrClose
+    };
+
+    std::vector<std::size_t> open; // tape indices of the open '{' / '['
+    Expect expect = Expect::Value;
+    bool inObject = false;         // innermost open container is an object
+    bool done = false;
+
+    for (std::size_t pos : indices)
+    {
+        if (done)
+            Fail(pos, "trailing content after the root value");
+        char c = text[pos];
+
+        switch (expect)
+        {
+        case Expect::Colon:
+            if (c != ':')
+                Fail(pos, "expected ':'");
+            expect = Expect::Value;
+            continue;
+        case Expect::Key:
+        case Expect::KeyOrClose:
+            if (c == '}' && expect == Expect::KeyOrClose)
+                break; // closes below
+            if (c != '"')
+                Fail(pos, "expected an object key");
+            document.ParseString(text, pos);
+            expect = Expect::Colon;
+            continue;
+        case Expect::CommaOrClose:
+            if (c == ',')
+            {
+                expect = inObject ? Expect::Key : Expect::Value;
+                continue;
+            }
+            if (c != (inObject ? '}' : ']'))
+                Fail(pos, inObject ? "expected ',' or '}'" : "expected ',' or ']'");
+            break; // closes below
+        case Expect::ValueOrClose:
+            if (c == ']')
+                break; // closes below
+            [[fallthrough]];
+        case Expect::Value:
+            if (c == '{' || c == '[')
+            {
+                if (open.size() >= MaxDepth)
+                    Fail(pos, "nesting too deep");
+                open.push_back(document.tape.size());
+                document.tape.push_back(Word(c, 0));
+                inObject = c == '{';
+                expect = inObject ? Expect::KeyOrClose : Expect::ValueOrClose;
+                continue;
+            }
+            if (c == '}' || c == ']' || c == ',' || c == ':')
+                Fail(pos, "expected a value");
+            document.ParseValueAt(text, pos);
+            expect = Expect::CommaOrClose;
+            done = open.empty();
+            continue;
+        }
+
+        // Closing the innermost container.
+        std::size_t start = open.back();
+        open.pop_back();
+        document.tape.push_back(Word(c, start));
+        document.tape[start] |= document.tape.size(); // payload: index just past the close
+        expect = Expect::CommaOrClose;
+        inObject = !open.empty() && (document.tape[open.back()] >> 56) == '{';
+        done = open.empty();
+    }
+
+    if (!done)
+        Fail(text.size(), open.empty() ? "empty document" : "unexpected end of input");
+    return document;
+}
+
+inline JsonType JsonValue::Type() const
+{
+    return static_cast<JsonType>(static_cast<char>(document->tape[index] >> 56));
+}
+
+inline std::size_t JsonValue::NextIndex() const
+{
+    switch (Type())
+    {
+    case JsonType::Object:
+    case JsonType::Array:
+        return static_cast<std::size_t>(document->tape[index] & 0x00ffffffffffffffULL);
+    case JsonType::Int64:
+    case JsonType::Double:
+        return index + 2;
+    default:
+        return index + 1;
+    }
+}
+
+inline bool JsonValue::AsBool() const
+{
+    if (Type() == JsonType::True)
+        return true;
+    if (Type() == JsonType::False)
+        return false;
+    throw std::runtime_error("JSON value is not a boolean");
+}
+
+inline std::int64_t JsonValue::AsInt64() const
+{
+    if (Type() != JsonType::Int64)
+        throw std::runtime_error("JSON value is not an integer");
+    return static_cast<std::int64_t>(document->tape[index + 1]);
+}
+
+inline double JsonValue::AsDouble() const
+{
+    if (Type() == JsonType::Int64)
+        return static_cast<double>(AsInt64());
+    if (Type() != JsonType::Double)
+        throw std::runtime_error("JSON value is not a number");
+    double value;
+    std::memcpy(&value, &document->tape[index + 1], sizeof(value));
+    return value;
+}
+
+inline std::string_view JsonValue::AsString() const
+{
+    if (Type() != JsonType::String)
+        throw std::runtime_error("JSON value is not a string");
+    std::size_t offset = static_cast<std::size_t>(document->tape[index] & 0x00ffffffffffffffULL);
+    std::uint32_t length;
+    std::memcpy(&length, document->strings.data() + offset, sizeof(length));
+    return std::string_view(document->strings.data() + offset + sizeof(length), length);
+}
+
+inline std::size_t JsonValue::Size() const
+{
+    if (Type() != JsonType::Object && Type() != JsonType::Array)
+        throw std::runtime_error("JSON value is not a container");
+    std::size_t end = NextIndex() - 1; // the closing word
+    std::size_t count = 0;
+    for (std::size_t i = index + 1; i < end; i = JsonValue(document, i).NextIndex())
+        count++;
+    return Type() == JsonType::Object ? count / 2 : count;
+}
+
+inline JsonValue JsonValue::operator[](std::size_t n) const
+{
+    if (Type() != JsonType::Array)
+        throw std::runtime_error("JSON value is not an array");
+    std::size_t end = NextIndex() - 1;
+    std::size_t i = index + 1;
+    for (; i < end && n > 0; n--)
+        i = JsonValue(document, i).NextIndex();
+    if (i >= end)
+        throw std::out_of_range("JSON array index out of range");
+    return JsonValue(document, i);
+}
+
+inline bool JsonValue::Contains(std::string_view key) const
+{
+    if (Type() != JsonType::Object)
+        return false;
+    std::size_t end = NextIndex() - 1;
+    for (std::size_t i = index + 1; i < end;)
+    {
+        JsonValue name(document, i);
+        JsonValue value(document, i + 1);
+        if (name.AsString() == key)
+            return true;
+        i = value.NextIndex();
+    }
+    return false;
+}
+
+inline JsonValue JsonValue::operator[](std::string_view key) const
+{
+    if (Type() != JsonType::Object)
+        throw std::runtime_error("JSON value is not an object");
+    std::size_t end = NextIndex() - 1;
+    for (std::size_t i = index + 1; i < end;)
+    {
+        JsonValue name(document, i);
+        JsonValue value(document, i + 1);
+        if (name.AsString() == key)
+            return value;
+        i = value.NextIndex();
+    }
+    throw std::out_of_range("JSON object has no member '" + std::string(key) + "'");
+}
+
+inline void AppendJsonString(std::string &out, std::string_view value)
+{
+    static const char Hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += "\\u00";
+                out += Hex[(c >> 4) & 0xf];
+                out += Hex[c & 0xf];
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+inline void JsonDocument::SerializeValue(std::string &out, std::size_t &i, bool pretty, int indent, int depth) const
+{
+    auto newline = [&](int level)
+    {
+        if (pretty)
+        {
+            out += '\n';
+            out.append(static_cast<std::size_t>(level * indent), ' ');
+        }
+    };
+
+    JsonValue value(this, i);
+    switch (value.Type())
+    {
+    case JsonType::Object:
+    case JsonType::Array:
+    {
+        bool isObject = value.Type() == JsonType::Object;
+        std::size_t end = value.NextIndex() - 1;
+        out += isObject ? '{' : '[';
+        bool first = true;
+        for (i = i + 1; i < end;)
+        {
+            if (!first)
+                out += ',';
+            first = false;
+            newline(depth + 1);
+            if (isObject)
+            {
+                AppendJsonString(out, JsonValue(this, i).AsString());
+                out += pretty ? ": " : ":";
+                i++;
+            }
+            SerializeValue(out, i, pretty, indent, depth + 1);
+        }
+        if (!first)
+            newline(depth);
+        out += isObject ? '}' : ']';
+        i = end + 1;
+        return;
+    }
+    case JsonType::String:
+        AppendJsonString(out, value.AsString());
+        break;
+    case JsonType::Int64:
+    case JsonType::Double:
+    {
+        char buffer[32];
+        auto result = value.Type() == JsonType::Int64
+                          ? std::to_chars(buffer, buffer + sizeof(buffer), value.AsInt64())
+                          : std::to_chars(buffer, buffer + sizeof(buffer), value.AsDouble());
+        out.append(buffer, result.ptr);
+        break;
+    }
+    case JsonType::True:
+        out += "true";
+        break;
+    case JsonType::False:
+        out += "false";
+        break;
+    case JsonType::Null:
+        out += "null";
+        break;
+    }
+    i = value.NextIndex();
+}
+
+inline std::string JsonDocument::Serialize(bool pretty, int indent) const
+{
+    std::string out;
+    out.reserve(strings.size() + tape.size() * 4);
+    std::size_t i = 0;
+    SerializeValue(out, i, pretty, indent, 0);
+    return out;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+/*
+Shared loading layer for the parsers: the input file is memory-mapped
+read-only and handed out as a std::string_view, so even multi-gigabyte inputs
+are never copied into the heap. A file already read into memory (by
+AsyncFileReader) is adopted instead and looks the same to the parsers.
+ParseResult keeps the "Parsed X File:" header apart from the body, which can
+point straight into the mapping.
+*/
+#include <memory>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <ostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class MappedFile
+{
+private:
+    const char *data;
+    std::size_t size;
+    std::unique_ptr<char[]> owned; // adopted buffer instead of a mapping
+
+    explicit MappedFile(const std::string &FilePath) : data(nullptr), size(0)
+    {
+        int fd = ::open(FilePath.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open file: " + FilePath);
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot open file: " + FilePath);
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        if (size > 0)
+        {
+            void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("Cannot map file: " + FilePath);
+            }
+            ::madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(mapping);
+        }
+        ::close(fd); // the mapping stays valid without the descriptor
+    }
+
+    MappedFile(std::unique_ptr<char[]> bytes, std::size_t size) : data(bytes.get()), size(size), owned(std::move(bytes)) {}
+
+public:
+    static std::shared_ptr<const MappedFile> Open(const std::string &FilePath)
+    {
+        return std::shared_ptr<const MappedFile>(new MappedFile(FilePath));
+    }
+
+    // Takes ownership of `size` bytes that were read some other way.
+    static std::shared_ptr<const MappedFile> Adopt(std::unique_ptr<char[]> bytes, std::size_t size)
+    {
+        return std::shared_ptr<const MappedFile>(new MappedFile(std::move(bytes), size));
+    }
+
+    ~MappedFile()
+    {
+        if (data && !owned)
+            ::munmap(const_cast<char *>(data), size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::string_view View() const { return std::string_view(data ? data : "", size); }
+};
+
+// What a FileParser produces: a short header and a body that either points
+// into the mapped input (zero copy) or holds text the parser generated.
+class ParseResult
+{
+private:
+    std::string header;
+    std::shared_ptr<const MappedFile> source; // keeps a borrowed body alive
+    std::string_view borrowedBody;
+    std::string ownedBody;
+
+public:
+    ParseResult(std::string header, std::shared_ptr<const MappedFile> source, std::string_view body)
+        : header(std::move(header)), source(std::move(source)), borrowedBody(body) {}
+
+    ParseResult(std::string header, std::string body)
+        : header(std::move(header)), ownedBody(std::move(body)) {}
+
+    const std::string &Header() const { return header; }
+    std::string_view Body() const { return source ? borrowedBody : std::string_view(ownedBody); }
+
+    // Header and body in one string, for callers that need a copy.
+    std::string ToString() const
+    {
+        std::string text;
+        text.reserve(header.size() + Body().size());
+        text += header;
+        text += Body();
+        return text;
+    }
+
+    void WriteTo(std::ostream &out) const
+    {
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(Body().data(), static_cast<std::streamsize>(Body().size()));
+    }
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef OBJECT_POOL_HPP
+#define OBJECT_POOL_HPP
+
+/*
+Free-list storage for objects that are created and destroyed at a high rate.
+
+ObjectPool<T> is one pool per type, so every slot has the size and alignment
+of T and slots of different types never mix. Slots come from slabs of
+SlabSlots and are never returned to the heap while the pool lives; a freed
+slot holds the link of its free list in its own bytes.
+
+Each thread keeps a small cache of free slots (up to CacheSlots), so the
+common create/destroy path touches no lock and no shared cache line. An empty
+cache takes a batch from the shared list (or a new slab) under the mutex; a
+full cache gives half of itself back. A thread's cache is returned to the
+shared list when the thread exits.
+
+    auto led = ObjectPool<Led>::Make();   // PoolPtr<Led>, back to the pool on reset
+    std::unique_ptr<IOutput, PoolDeleter> base = std::move(led);
+
+PoolDeleter remembers the concrete type, so a pointer to a base class still
+goes back to the right pool. Objects must be released before the pool is
+destroyed at exit, i.e. must not live in other static objects.
+*/
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Destroys an object made by ObjectPool<T>::Make and gives its slot back.
+class PoolDeleter
+{
+private:
+    void (*release)(void *) = nullptr;
+
+public:
+    PoolDeleter() = default;
+    explicit PoolDeleter(void (*release)(void *)) : release(release) {}
+
+    template <typename T>
+    void operator()(T *object) const
+    {
+        if (!object)
+            return;
+        if constexpr (std::is_polymorphic_v<T>)
+            release(dynamic_cast<void *>(object)); // the complete object, wherever the base sits
+        else
+            release(object);
+    }
+};
+
+template <typename T>
+using PoolPtr = std::unique_ptr<T, PoolDeleter>;
+
+template <typename T>
+class ObjectPool
+{
+private:
+    static constexpr std::size_t SlabSlots = 1024;
+    static constexpr std::size_t CacheSlots = 256; // per thread
+
+    union Slot
+    {
+        Slot *next;
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    // A chain of free slots and its length.
+    struct FreeList
+    {
+        Slot *head = nullptr;
+        std::size_t count = 0;
+
+        void Push(Slot *slot)
+        {
+            slot->next = head;
+            head = slot;
+            count++;
+        }
+
+        Slot *Pop()
+        {
+            Slot *slot = head;
+            head = slot->next;
+            count--;
+            return slot;
+        }
+
+        // Moves up to `wanted` slots from the front of this list to `to`.
+        void MoveTo(FreeList &to, std::size_t wanted)
+        {
+            while (wanted-- > 0 && head)
+                to.Push(Pop());
+        }
+    };
+
+    struct LocalCache
+    {
+        FreeList free;
+
+        ~LocalCache()
+        {
+            if (free.count > 0)
+                Instance().GiveBack(free, free.count);
+        }
+    };
+
+    std::mutex mutex;
+    FreeList shared;
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+
+    ObjectPool() = default;
+
+    static LocalCache &Local()
+    {
+        static thread_local LocalCache cache;
+        return cache;
+    }
+
+    // Fills an empty thread cache with half a cache of slots.
+    void Refill(FreeList &local)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (shared.count == 0)
+        {
+            slabs.emplace_back(new Slot[SlabSlots]);
+            Slot *slab = slabs.back().get();
+            for (std::size_t i = SlabSlots; i-- > 0;)
+                shared.Push(&slab[i]);
+        }
+        shared.MoveTo(local, CacheSlots / 2);
+    }
+
+    void GiveBack(FreeList &local, std::size_t count)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        local.MoveTo(shared, count);
+    }
+
+    static void Release(void *object)
+    {
+        static_cast<T *>(object)->~T();
+        Slot *slot = reinterpret_cast<Slot *>(object);
+        FreeList &local = Local().free;
+        local.Push(slot);
+        if (local.count > CacheSlots)
+            Instance().GiveBack(local, CacheSlots / 2);
+    }
+
+public:
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    static ObjectPool &Instance()
+    {
+        static ObjectPool pool;
+        return pool;
+    }
+
+    // Constructs a T in a pooled slot.
+    template <typename... Args>
+    static PoolPtr<T> Make(Args &&...args)
+    {
+        FreeList &local = Local().free;
+        if (local.count == 0)
+            Instance().Refill(local);
+        Slot *slot = local.Pop();
+        try
+        {
+            T *object = ::new (static_cast<void *>(slot->bytes)) T(std::forward<Args>(args)...);
+            return PoolPtr<T>(object, PoolDeleter(&ObjectPool::Release));
+        }
+        catch (...)
+        {
+            local.Push(slot);
+            throw;
+        }
+    }
+
+    // Slabs allocated so far, each SlabSlots objects.
+    std::size_t Slabs()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return slabs.size();
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef OUTPUT_WRITER_HPP
+#define OUTPUT_WRITER_HPP
+
+/*
+Writes parse results to a file without first joining them into one string.
+Each result contributes its header, its body and an optional separator as
+three iovecs; a body borrowed from the input mapping goes to writev straight
+from the mapped pages, so the only copy left is the kernel's into the page
+cache.
+
+Results are queued as they arrive (the writer keeps them, and with them their
+mappings, alive) and flushed with one writev per batch of up to FlushIovecs
+iovecs or FlushBytes bytes, so small results are coalesced and large ones
+leave memory as soon as they are written. A batch parse can therefore stream
+its output while later files are still being parsed.
+
+The output goes to a temporary file next to the destination; Commit flushes,
+fsyncs and renames it over the destination, so readers see either the old
+file or the complete new one. A writer destroyed without Commit removes its
+temporary file.
+*/
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "MappedFile.hpp"
+
+class OutputWriter
+{
+private:
+    static constexpr std::size_t FlushIovecs = 512;             // under IOV_MAX (1024)
+    static constexpr std::uint64_t FlushBytes = 4 * 1024 * 1024; // bytes queued before a flush
+
+    struct Pending
+    {
+        ParseResult result;
+        std::string_view separator;
+    };
+
+    std::string path;
+    std::string temporary;
+    int fd = -1;
+    std::deque<Pending> pending;
+    std::size_t pendingIovecs = 0;
+    std::uint64_t pendingBytes = 0;
+    std::uint64_t written = 0;
+    std::uint64_t writeCalls = 0;
+
+    static void AddIovec(std::vector<iovec> &iovecs, std::string_view part)
+    {
+        if (!part.empty())
+            iovecs.push_back(iovec{const_cast<char *>(part.data()), part.size()});
+    }
+
+    // Writes all of `iovecs`, resuming after short writes.
+    void WriteAll(std::vector<iovec> &iovecs)
+    {
+        std::size_t first = 0;
+        while (first < iovecs.size())
+        {
+            int count = static_cast<int>(std::min<std::size_t>(iovecs.size() - first, FlushIovecs));
+            ssize_t done = ::writev(fd, iovecs.data() + first, count);
+            if (done < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Cannot write output: " + temporary + ": " + std::strerror(errno));
+            }
+            writeCalls++;
+            written += static_cast<std::uint64_t>(done);
+            std::size_t remaining = static_cast<std::size_t>(done);
+            while (first < iovecs.size() && remaining >= iovecs[first].iov_len)
+                remaining -= iovecs[first++].iov_len;
+            if (remaining > 0)
+            {
+                iovecs[first].iov_base = static_cast<char *>(iovecs[first].iov_base) + remaining;
+                iovecs[first].iov_len -= remaining;
+            }
+        }
+    }
+
+public:
+    // Creates the temporary file `FilePath`.tmp.<pid>; the destination is only
+    // replaced by Commit.
+    explicit OutputWriter(std::string FilePath)
+        : path(std::move(FilePath)), temporary(path + ".tmp." + std::to_string(::getpid()))
+    {
+        fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Cannot write output: " + temporary);
+    }
+
+    ~OutputWriter()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            ::unlink(temporary.c_str());
+        }
+    }
+
+    OutputWriter(const OutputWriter &) = delete;
+    OutputWriter &operator=(const OutputWriter &) = delete;
+
+    // Queues a result followed by `separator` (which must outlive the next
+    // flush, e.g. a literal) and flushes when the queue is full.
+    void Append(ParseResult result, std::string_view separator = std::string_view())
+    {
+        std::uint64_t bytes = result.Header().size() + result.Body().size() + separator.size();
+        pending.push_back(Pending{std::move(result), separator});
+        pendingIovecs += 3;
+        pendingBytes += bytes;
+        if (pendingIovecs >= FlushIovecs || pendingBytes >= FlushBytes)
+            Flush();
+    }
+
+    // Writes everything queued and releases the results.
+    void Flush()
+    {
+        if (pending.empty())
+            return;
+        std::vector<iovec> iovecs;
+        iovecs.reserve(pendingIovecs);
+        for (const Pending &item : pending)
+        {
+            AddIovec(iovecs, item.result.Header());
+            AddIovec(iovecs, item.result.Body());
+            AddIovec(iovecs, item.separator);
+        }
+        WriteAll(iovecs);
+        pending.clear();
+        pendingIovecs = 0;
+        pendingBytes = 0;
+    }
+
+    // Flushes, syncs and renames the temporary file over the destination.
+    void Commit()
+    {
+        if (fd < 0)
+            throw std::runtime_error("Output already committed: " + path);
+        Flush();
+        if (::fsync(fd) != 0)
+            throw std::runtime_error("Cannot write output: " + temporary + ": " + std::strerror(errno));
+        ::close(fd);
+        fd = -1;
+        if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            ::unlink(temporary.c_str());
+            throw std::runtime_error("Cannot replace output: " + path);
+        }
+    }
+
+    std::uint64_t BytesWritten() const { return written; }
+    std::uint64_t WriteCalls() const { return writeCalls; }
+};
+
+#endif
@@ -0,0 +1,344 @@
+#ifndef PARSE_CACHE_HPP
+#define PARSE_CACHE_HPP
+
+/*
+Persistent cache of parse results, so re-running over unchanged inputs skips
+parsing. An entry is keyed by the absolute path and remembers the size,
+modification time and a 64-bit content hash of the input it was made from.
+
+A lookup stats the input: a different size is a miss; the same size and
+mtime is a hit after the content hash is checked (or without reading the
+file at all when verifyContent is off); the same size with another mtime is
+a hit if the content hash still matches, so a touched file is not re-parsed.
+
+On disk the cache is one binary file, memory-mapped by the constructor;
+bodies loaded from it are handed out as views into that mapping without a
+copy. Entries are stored most recently used first, which is how the LRU
+order survives a restart:
+
+    "PCACHE01"  u32 version  u32 entry count
+    per entry:  u64 size  i64 mtime (ns)  u64 content hash
+                u32 path length  u32 header length  u64 body length
+                path  header  body
+
+All integers are in host byte order; a file from another version or a
+truncated file is ignored (the cache starts empty). Save writes a temporary
+file and renames it over the old one, so a crash never leaves a torn cache.
+
+The entries are kept under a byte budget by evicting the least recently
+used. Lookups may come from several threads; parsing on a miss runs outside
+the lock.
+*/
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <sys/stat.h>
+#include "MappedFile.hpp"
+
+// 64-bit content hash, eight bytes per step.
+inline std::uint64_t HashContent(std::string_view data)
+{
+    const std::uint64_t prime = 0x9E3779B97F4A7C15ULL;
+    std::uint64_t hash = data.size() * prime;
+    std::size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, data.data() + i, data.size() - i);
+    hash = (hash ^ tail) * prime;
+    hash ^= hash >> 32;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+struct ParseCacheOptions
+{
+    std::uint64_t budgetBytes = 256ull * 1024 * 1024; // on-disk size of all entries
+    bool verifyContent = true; // hash the input even when size and mtime match
+};
+
+struct ParseCacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t bytesSkipped = 0; // input bytes whose parse a hit saved
+    std::size_t entries = 0;
+    std::uint64_t bytes = 0;
+};
+
+class ParseCache
+{
+private:
+    static constexpr char Magic[8] = {'P', 'C', 'A', 'C', 'H', 'E', '0', '1'};
+    static constexpr std::uint32_t Version = 1;
+    static constexpr std::size_t EntryFixedBytes = 8 + 8 + 8 + 4 + 4 + 8;
+
+    struct Entry
+    {
+        std::string path;
+        std::uint64_t size = 0;
+        std::int64_t mtime = 0;
+        std::uint64_t hash = 0;
+        std::string header;
+        std::string_view body;  // into `stored` or the loaded mapping
+        std::string stored;     // body of an entry added in this run
+
+        std::uint64_t Bytes() const { return EntryFixedBytes + path.size() + header.size() + body.size(); }
+    };
+
+    std::string cachePath;
+    ParseCacheOptions options;
+    std::shared_ptr<const MappedFile> loaded; // bodies of loaded entries point here
+
+    mutable std::mutex mutex;
+    std::list<Entry> lru; // most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // keys view Entry::path
+    std::uint64_t bytes = 0;
+    std::uint64_t evictions = 0;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> bytesSkipped{0};
+
+    static std::int64_t ModifiedNs(const struct stat &info)
+    {
+        return static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    }
+
+    // Drops least recently used entries until the cache fits its budget.
+    void EvictLocked()
+    {
+        while (bytes > options.budgetBytes && !lru.empty())
+        {
+            Entry &victim = lru.back();
+            bytes -= victim.Bytes();
+            index.erase(victim.path);
+            lru.pop_back();
+            evictions++;
+        }
+    }
+
+    void InsertLocked(Entry entry)
+    {
+        auto existing = index.find(entry.path);
+        if (existing != index.end())
+        {
+            auto stale = existing->second;
+            bytes -= stale->Bytes();
+            index.erase(existing);
+            lru.erase(stale);
+        }
+        lru.push_front(std::move(entry));
+        Entry &inserted = lru.front();
+        if (!inserted.stored.empty())
+            inserted.body = inserted.stored; // the string moved with the entry
+        index.emplace(inserted.path, lru.begin());
+        bytes += inserted.Bytes();
+        EvictLocked();
+    }
+
+    void Load()
+    {
+        std::error_code ec;
+        if (!std::filesystem::exists(cachePath, ec))
+            return;
+        loaded = MappedFile::Open(cachePath);
+        std::string_view data = loaded->View();
+        std::size_t at = 0;
+        auto read = [&](void *out, std::size_t length)
+        {
+            if (data.size() - at < length)
+                return false;
+            std::memcpy(out, data.data() + at, length);
+            at += length;
+            return true;
+        };
+
+        char magic[8];
+        std::uint32_t version = 0;
+        std::uint32_t count = 0;
+        if (!read(magic, 8) || std::memcmp(magic, Magic, 8) != 0 || !read(&version, 4) || version != Version ||
+            !read(&count, 4))
+            return;
+        std::list<Entry> entries;
+        for (std::uint32_t i = 0; i < count; i++)
+        {
+            Entry entry;
+            std::uint32_t pathLength = 0;
+            std::uint32_t headerLength = 0;
+            std::uint64_t bodyLength = 0;
+            if (!read(&entry.size, 8) || !read(&entry.mtime, 8) || !read(&entry.hash, 8) || !read(&pathLength, 4) ||
+                !read(&headerLength, 4) || !read(&bodyLength, 8) ||
+                data.size() - at < std::uint64_t(pathLength) + headerLength + bodyLength)
+                return; // truncated: start empty
+            entry.path.assign(data.data() + at, pathLength);
+            at += pathLength;
+            entry.header.assign(data.data() + at, headerLength);
+            at += headerLength;
+            entry.body = data.substr(at, bodyLength);
+            at += bodyLength;
+            entries.push_back(std::move(entry));
+        }
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+            InsertLocked(std::move(*it)); // least recently used first, so the order is kept
+    }
+
+public:
+    // Loads the cache file if there is a valid one; a missing file is an
+    // empty cache.
+    explicit ParseCache(std::string cachePath, ParseCacheOptions options = ParseCacheOptions())
+        : cachePath(std::move(cachePath)), options(options)
+    {
+        Load();
+    }
+
+    ParseCache(const ParseCache &) = delete;
+    ParseCache &operator=(const ParseCache &) = delete;
+
+    // The cached result for `FilePath`, or parse(FilePath) stored for next
+    // time. Errors from parse are not cached.
+    template <typename Parse>
+    ParseResult GetOrParse(const std::string &FilePath, Parse &&parse)
+    {
+        std::string key = std::filesystem::absolute(FilePath).lexically_normal().string();
+        struct stat info;
+        if (::stat(FilePath.c_str(), &info) != 0)
+            throw std::runtime_error("Cannot open file: " + FilePath);
+        std::uint64_t size = static_cast<std::uint64_t>(info.st_size);
+        std::int64_t mtime = ModifiedNs(info);
+
+        bool sameSize = false;
+        bool sameTime = false;
+        std::uint64_t cachedHash = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = index.find(key);
+            if (found != index.end())
+            {
+                const Entry &entry = *found->second;
+                sameSize = entry.size == size;
+                sameTime = entry.mtime == mtime;
+                cachedHash = entry.hash;
+            }
+        }
+
+        std::uint64_t hash = 0;
+        bool hashed = false;
+        if (sameSize)
+        {
+            if (sameTime && !options.verifyContent)
+            {
+                hash = cachedHash;
+            }
+            else
+            {
+                hash = HashContent(MappedFile::Open(FilePath)->View());
+                hashed = true;
+            }
+            if (hash == cachedHash)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto found = index.find(key);
+                if (found != index.end() && found->second->hash == hash && found->second->size == size)
+                {
+                    lru.splice(lru.begin(), lru, found->second);
+                    Entry &entry = lru.front();
+                    entry.mtime = mtime;
+                    hits.fetch_add(1, std::memory_order_relaxed);
+                    bytesSkipped.fetch_add(size, std::memory_order_relaxed);
+                    if (entry.stored.empty() && loaded && !entry.body.empty())
+                        return ParseResult(entry.header, loaded, entry.body);
+                    return ParseResult(entry.header, std::string(entry.body));
+                }
+            }
+        }
+
+        misses.fetch_add(1, std::memory_order_relaxed);
+        ParseResult result = parse(FilePath);
+        Entry entry;
+        entry.path = std::move(key);
+        entry.size = size;
+        entry.mtime = mtime;
+        entry.hash = hashed ? hash : HashContent(MappedFile::Open(FilePath)->View());
+        entry.header = result.Header();
+        entry.body = result.Body(); // counted by Bytes(); InsertLocked repoints it at `stored`
+        if (entry.Bytes() <= options.budgetBytes)
+        {
+            entry.stored.assign(entry.body);
+            std::lock_guard<std::mutex> lock(mutex);
+            InsertLocked(std::move(entry));
+        }
+        return result;
+    }
+
+    // Writes the cache file (temporary file, then rename).
+    void Save() const
+    {
+        std::string temporary = cachePath + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+                throw std::runtime_error("Cannot write parse cache: " + temporary);
+            std::lock_guard<std::mutex> lock(mutex);
+            auto write = [&](const void *data, std::size_t length)
+            {
+                out.write(static_cast<const char *>(data), static_cast<std::streamsize>(length));
+            };
+            std::uint32_t count = static_cast<std::uint32_t>(lru.size());
+            write(Magic, 8);
+            write(&Version, 4);
+            write(&count, 4);
+            for (const Entry &entry : lru)
+            {
+                std::uint32_t pathLength = static_cast<std::uint32_t>(entry.path.size());
+                std::uint32_t headerLength = static_cast<std::uint32_t>(entry.header.size());
+                std::uint64_t bodyLength = entry.body.size();
+                write(&entry.size, 8);
+                write(&entry.mtime, 8);
+                write(&entry.hash, 8);
+                write(&pathLength, 4);
+                write(&headerLength, 4);
+                write(&bodyLength, 8);
+                write(entry.path.data(), pathLength);
+                write(entry.header.data(), headerLength);
+                write(entry.body.data(), entry.body.size());
+            }
+            out.flush();
+            if (!out)
+                throw std::runtime_error("Cannot write parse cache: " + temporary);
+        }
+        if (std::rename(temporary.c_str(), cachePath.c_str()) != 0)
+            throw std::runtime_error("Cannot replace parse cache: " + cachePath);
+    }
+
+    ParseCacheStats Stats() const
+    {
+        ParseCacheStats stats;
+        stats.hits = hits.load(std::memory_order_relaxed);
+        stats.misses = misses.load(std::memory_order_relaxed);
+        stats.bytesSkipped = bytesSkipped.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.evictions = evictions;
+        stats.entries = lru.size();
+        stats.bytes = bytes;
+        return stats;
+    }
+};
+
+#endif
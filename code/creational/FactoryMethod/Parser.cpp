@@ -1,134 +1,96 @@
 #include <iostream>
-#include <fstream>
 #include <memory>
 #include <string>
-#include <stdexcept>
-
-class FileParser
-{
-public:
-    virtual std::string parse(const std::string &FilePath) const = 0;
-    virtual ~FileParser() = default;
-};
-
-class TextParser : public FileParser
+#include <iomanip>
+#include "FileParsers.hpp"
+#include "BatchParser.hpp"
+#include "ParseCache.hpp"
+#include "OutputWriter.hpp"
+
+// Parser --batch <directory | list file> [--threads N] [--max-inflight MB] [--as-completed]
+//               [--async-read [--read-depth N]] [--cache FILE [--cache-budget MB]]
+// Streams every result into output.txt and prints per-file and total throughput.
+static int RunBatch(int argc, const char **argv)
 {
-public:
-    std::string parse(const std::string &FilePath) const override
+    if (argc < 3)
     {
-        std::ifstream file(FilePath);
-        if (!file.is_open())
-            throw std::runtime_error("Cannot open file: " + FilePath);
-
-        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        file.close();
-        return "Parsed Text File:\n" + content;
+        std::cerr << "usage: " << argv[0]
+                  << " --batch <directory | list file> [--threads N] [--max-inflight MB] [--as-completed]"
+                  << " [--async-read [--read-depth N]] [--cache FILE [--cache-budget MB]]" << std::endl;
+        return 1;
     }
-};
-
-class JsonParser : public FileParser
-{
-public:
-    std::string parse(const std::string &FilePath) const override
+    BatchOptions options;
+    std::string cachePath;
+    ParseCacheOptions cacheOptions;
+    for (int i = 3; i < argc; i++)
     {
-        std::ifstream file(FilePath);
-        if (!file.is_open())
-            throw std::runtime_error("Cannot open file: " + FilePath);
-
-        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        file.close();
-        return "Parsed JSON File:\n" + content;
+        std::string option = argv[i];
+        if (option == "--threads" && i + 1 < argc)
+            options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (option == "--max-inflight" && i + 1 < argc)
+            options.maxInFlightBytes = std::stoull(argv[++i]) * 1024 * 1024;
+        else if (option == "--as-completed")
+            options.inputOrder = false;
+        else if (option == "--async-read")
+            options.asyncRead = true;
+        else if (option == "--read-depth" && i + 1 < argc)
+            options.readDepth = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (option == "--cache" && i + 1 < argc)
+            cachePath = argv[++i];
+        else if (option == "--cache-budget" && i + 1 < argc)
+            cacheOptions.budgetBytes = std::stoull(argv[++i]) * 1024 * 1024;
     }
-};
 
-class XmlParser : public FileParser
-{
-public:
-    std::string parse(const std::string &FilePath) const override
-    {
-        std::ifstream file(FilePath);
-        if (!file.is_open())
-            throw std::runtime_error("Cannot open file: " + FilePath);
-
-        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        file.close();
-        return "Parsed XML File:\n" + content;
-    }
-};
-
-class CsvParser : public FileParser
-{
-public:
-    std::string parse(const std::string &FilePath) const override
+    try
     {
-        std::ifstream file(FilePath);
-        if (!file.is_open())
-            throw std::runtime_error("Cannot open file: " + FilePath);
-
-        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        file.close();
-        return "Parsed CSV File:\n" + content;
+        std::vector<std::string> paths = BatchParser::ListInputs(argv[2]);
+        std::unique_ptr<ParseCache> cache;
+        if (!cachePath.empty())
+            cache = std::make_unique<ParseCache>(cachePath, cacheOptions);
+        options.cache = cache.get();
+        OutputWriter output("output.txt");
+        BatchSummary summary = BatchParser::Run(paths, options, [&](BatchFileResult &item)
+        {
+            std::cout << item.path << ": ";
+            if (!item.result)
+            {
+                std::cout << "error: " << item.error << std::endl;
+                return;
+            }
+            output.Append(std::move(*item.result), "\n");
+            std::cout << item.bytes << " bytes, " << std::fixed << std::setprecision(3) << item.seconds * 1000
+                      << " ms, " << std::setprecision(1) << item.MegabytesPerSecond() << " MB/s" << std::endl;
+        });
+        std::cout << summary.files << " files (" << summary.failed << " failed), " << summary.bytes << " bytes in "
+                  << std::setprecision(3) << summary.seconds << " s: " << std::setprecision(1)
+                  << summary.MegabytesPerSecond() << " MB/s on " << options.threads << " threads, "
+                  << summary.steals << " steals" << std::endl;
+        output.Commit();
+        if (cache)
+        {
+            cache->Save();
+            PrintCacheStats(*cache);
+        }
+        std::cout << "Output saved to 'output.txt'." << std::endl;
     }
-};
-
-class YamlParser : public FileParser
-{
-public:
-    std::string parse(const std::string &FilePath) const override
+    catch (const std::exception &ex)
     {
-        std::ifstream file(FilePath);
-        if (!file.is_open())
-            throw std::runtime_error("Cannot open file: " + FilePath);
-
-        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        file.close();
-        return "Parsed YAML File:\n" + content;
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
     }
-};
-class ParserFactory
-{
-public:
-    static std::unique_ptr<FileParser> createParser(const std::string &file_type);
-};
+    return 0;
+}
 
-std::unique_ptr<FileParser> ParserFactory::createParser(const std::string &file_type)
+int main(int argc, const char **argv)
 {
-    if ("txt" == file_type)
-    {
-        return std::make_unique<TextParser>();
-    }
-    else if ("json" == file_type)
+    if (argc > 1 && std::string(argv[1]) == "--batch")
     {
-        return std::make_unique<JsonParser>();
+        return RunBatch(argc, argv);
     }
-    else if ("xml" == file_type)
-    {
-        return std::make_unique<XmlParser>();
-    }
-    else if ("csv" == file_type)
-    {
-        return std::make_unique<CsvParser>();
-    }
-    else if ("yaml" == file_type)
-    {
-        return std::make_unique<YamlParser>();
-    }
-    else
-    {
-        throw std::invalid_argument("Unsupported file type ");
-    }
-}
 
-// Utility Function to Extract File Extension
-std::string getFileExtension(const std::string &fileName)
-{
-    size_t dotPos = fileName.rfind('.');
-    if (dotPos == std::string::npos)
-        throw std::invalid_argument("No file extension found in: " + fileName);
-    return fileName.substr(dotPos + 1);
-}
-int main(int argc, const char **argv)
-{
+    std::unique_ptr<ParseCache> cache; // Parser --cache FILE
+    if (argc > 2 && std::string(argv[1]) == "--cache")
+        cache = std::make_unique<ParseCache>(argv[2]);
 
     std::string filePath;
     std::cout << "Enter the file path: ";
@@ -136,16 +98,16 @@ int main(int argc, const char **argv)
 
     try
     {
-        std::string fileType = getFileExtension(filePath);
-        auto parser = ParserFactory::createParser(fileType);
-
-        std::string result = parser->parse(filePath);
-        std::cout << result << std::endl;
+        ParseResult result = cache ? cache->GetOrParse(filePath, ParseDetected) : ParseDetected(filePath);
+        if (cache)
+            cache->Save();
+        result.WriteTo(std::cout);
+        std::cout << std::endl;
 
         // Save to a unified output file
-        std::ofstream outFile("output.txt");
-        outFile << result;
-        outFile.close();
+        OutputWriter output("output.txt");
+        output.Append(std::move(result));
+        output.Commit();
         std::cout << "Output saved to 'output.txt'." << std::endl;
     }
     catch (const std::exception &ex)
@@ -154,4 +116,4 @@ int main(int argc, const char **argv)
     }
 
     return 0;
-}
\ No newline at end of file
+}
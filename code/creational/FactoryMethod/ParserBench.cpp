@@ -0,0 +1,1523 @@
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+#include <filesystem>
+#include <iomanip>
+#include <cstring>
+#include <functional>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "FileParsers.hpp"
+#include "BatchParser.hpp"
+#include "ParseCache.hpp"
+#include "AsyncFileReader.hpp"
+#include "OutputWriter.hpp"
+
+// Heap allocations of the whole process, for the benchmark suite. Counting
+// is two relaxed atomic adds per allocation; it lives in this program only,
+// not in Parser.
+static std::atomic<std::uint64_t> heapAllocations{0};
+static std::atomic<std::uint64_t> heapAllocatedBytes{0};
+
+void *operator new(std::size_t size)
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    heapAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *block = std::malloc(size ? size : 1))
+        return block;
+    throw std::bad_alloc();
+}
+
+// Out of line, so the compiler does not pair an inlined free() with new.
+__attribute__((noinline)) void operator delete(void *block) noexcept { std::free(block); }
+__attribute__((noinline)) void operator delete(void *block, std::size_t) noexcept { std::free(block); }
+
+// Deterministic generator for the JSON benchmark corpus.
+class JsonCorpusGenerator
+{
+private:
+    std::uint64_t state;
+
+    std::uint32_t Next()
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<std::uint32_t>(state >> 33);
+    }
+
+    void AppendString(std::string &out, std::size_t length)
+    {
+        static const char *pieces[] = {"alpha", " ", "beta", "\\\"", "\\n", "\\u00e9", "caf\xc3\xa9", "\\ud83d\\ude00", "0123456789"};
+        out += '"';
+        while (length > 0)
+        {
+            const char *piece = pieces[Next() % 9];
+            out += piece;
+            length = length > 8 ? length - 8 : 0;
+        }
+        out += '"';
+    }
+
+    void AppendValue(std::string &out, int depth, int maxDepth)
+    {
+        std::uint32_t kind = depth >= maxDepth ? Next() % 5 : Next() % 7;
+        switch (kind)
+        {
+        case 0:
+            AppendString(out, 4 + Next() % 40);
+            break;
+        case 1:
+            out += std::to_string(static_cast<std::int32_t>(Next()));
+            break;
+        case 2:
+            out += std::to_string(Next() % 100000) + "." + std::to_string(Next() % 1000) + "e-3";
+            break;
+        case 3:
+            out += Next() % 2 ? "true" : "false";
+            break;
+        case 4:
+            out += "null";
+            break;
+        case 5:
+        {
+            out += "[";
+            std::uint32_t count = Next() % 6;
+            for (std::uint32_t i = 0; i < count; i++)
+            {
+                if (i)
+                    out += ", ";
+                AppendValue(out, depth + 1, maxDepth);
+            }
+            out += "]";
+            break;
+        }
+        default:
+        {
+            out += "{";
+            std::uint32_t count = Next() % 6;
+            for (std::uint32_t i = 0; i < count; i++)
+            {
+                out += i ? ",\n  " : "\n  ";
+                AppendString(out, 3 + Next() % 12);
+                out += ": ";
+                AppendValue(out, depth + 1, maxDepth);
+            }
+            out += "}";
+        }
+        }
+    }
+
+public:
+    explicit JsonCorpusGenerator(std::uint64_t seed) : state(seed) {}
+
+    // Array of records, about `bytes` long, nested up to `maxDepth`.
+    std::string Records(std::size_t bytes, int maxDepth)
+    {
+        std::string out = "[\n";
+        while (out.size() < bytes)
+        {
+            if (out.size() > 2)
+                out += ",\n";
+            AppendValue(out, 0, maxDepth);
+        }
+        out += "\n]";
+        return out;
+    }
+
+    // A chain of nested arrays and objects `depth` levels deep.
+    std::string Deep(int depth)
+    {
+        std::string out;
+        for (int i = 0; i < depth; i++)
+            out += i % 2 ? "[" : "{\"k\": ";
+        out += "42";
+        for (int i = depth - 1; i >= 0; i--)
+            out += i % 2 ? "]" : "}";
+        return out;
+    }
+
+    // Newline-delimited records, one compact value per line.
+    std::string Lines(std::size_t bytes, int maxDepth)
+    {
+        std::string out;
+        std::string record;
+        while (out.size() < bytes)
+        {
+            record.clear();
+            AppendValue(record, 0, maxDepth);
+            for (char &c : record)
+            {
+                if (c == '\n')
+                    c = ' '; // only formatting newlines: strings hold "\\n" escapes
+            }
+            out += record;
+            out += '\n';
+        }
+        return out;
+    }
+
+    // A few very long strings full of escapes.
+    std::string LongStrings(std::size_t bytes)
+    {
+        std::string out = "[";
+        while (out.size() < bytes)
+        {
+            if (out.size() > 1)
+                out += ",";
+            AppendString(out, 64 * 1024);
+        }
+        out += "]";
+        return out;
+    }
+};
+
+// Validates the JSON parser on example.json and a generated corpus (every
+// kernel must find the same structurals and the parse must round-trip), then
+// reports stage 1 and full parse throughput.
+static int RunJsonBenchmark(std::size_t megabytes)
+{
+    JsonDocument example = JsonParser().parseDocument("example.json");
+    if (example.Root()["name"].AsString() != "Document Converter" || example.Root()["features"].Size() != 3)
+    {
+        std::cerr << "example.json: unexpected content" << std::endl;
+        return 1;
+    }
+    std::cout << "example.json: ok" << std::endl;
+
+    JsonCorpusGenerator generator(42);
+    std::size_t bytes = megabytes * 1024 * 1024;
+    std::vector<std::pair<std::string, std::string>> corpus = {
+        {"records", generator.Records(bytes, 6)},
+        {"deep", generator.Deep(static_cast<int>(JsonDocument::MaxDepth))},
+        {"long-strings", generator.LongStrings(bytes)},
+    };
+
+    std::vector<JsonKernel> kernels = {JsonKernel::Scalar};
+    if (BestJsonKernel() != JsonKernel::Scalar)
+        kernels.push_back(JsonKernel::Sse2);
+    if (BestJsonKernel() == JsonKernel::Avx2)
+        kernels.push_back(JsonKernel::Avx2);
+
+    for (const auto &input : corpus)
+    {
+        const std::string &text = input.second;
+        std::vector<std::size_t> reference = FindJsonStructurals(text, JsonKernel::Scalar);
+        std::string compact = JsonDocument::Parse(text, JsonKernel::Scalar).Serialize(false);
+        if (JsonDocument::Parse(compact).Serialize(false) != compact)
+        {
+            std::cerr << input.first << ": round trip mismatch" << std::endl;
+            return 1;
+        }
+
+        std::cout << input.first << " (" << text.size() / 1024 << " KiB)" << std::endl;
+        for (JsonKernel kernel : kernels)
+        {
+            const int repeats = 5;
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::size_t> indices;
+            for (int r = 0; r < repeats; r++)
+                indices = FindJsonStructurals(text, kernel);
+            std::chrono::duration<double> scan = std::chrono::steady_clock::now() - start;
+
+            start = std::chrono::steady_clock::now();
+            std::string result;
+            for (int r = 0; r < repeats; r++)
+                result = JsonDocument::Parse(text, kernel).Serialize(false);
+            std::chrono::duration<double> parse = std::chrono::steady_clock::now() - start;
+
+            if (indices != reference || result != compact)
+            {
+                std::cerr << "  " << JsonKernelName(kernel) << ": result differs from the scalar kernel" << std::endl;
+                return 1;
+            }
+            double gigabytes = repeats * static_cast<double>(text.size()) / 1e9;
+            std::cout << "  " << JsonKernelName(kernel) << ": stage 1 " << gigabytes / scan.count()
+                      << " GB/s, parse+serialize " << gigabytes / parse.count() << " GB/s" << std::endl;
+        }
+    }
+    return 0;
+}
+
+// Deterministic wide CSV export: numeric and text columns, quoted fields with
+// delimiters, doubled quotes and line breaks, empty fields and CRLF rows.
+static std::string GenerateCsvCorpus(std::size_t bytes, std::size_t columns, std::uint64_t seed)
+{
+    std::uint64_t state = seed;
+    auto next = [&state]()
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<std::uint32_t>(state >> 33);
+    };
+
+    std::string out;
+    for (std::size_t c = 0; c < columns; c++)
+        out += (c ? ",col" : "col") + std::to_string(c);
+    out += "\n";
+    while (out.size() < bytes)
+    {
+        for (std::size_t c = 0; c < columns; c++)
+        {
+            if (c)
+                out += ',';
+            std::uint32_t r = next();
+            if (r % 50 == 0)
+                continue; // null
+            switch (c % 4)
+            {
+            case 0:
+                out += std::to_string(static_cast<std::int32_t>(r));
+                break;
+            case 1:
+                out += std::to_string(r % 100000) + "." + std::to_string(r % 997 / 10 * 10 + 1); // no trailing zero
+                break;
+            case 2:
+                out += "item-" + std::to_string(r % 10000);
+                break;
+            default:
+                out += r % 3 == 0 ? "\"Smith, \"\"J\"\"\nline two\"" : "\"plain quoted\"";
+            }
+        }
+        out += next() % 4 == 0 ? "\r\n" : "\n";
+    }
+    return out;
+}
+
+// Validates the CSV engine on example.csv and a generated export (all kernels
+// must agree, row counts must match the full parse, output must round-trip),
+// then reports full, projected and count-only throughput.
+static int RunCsvBenchmark(std::size_t megabytes)
+{
+    CsvTable example = CsvParser().parseTable("example.csv");
+    if (example.Rows() != 3 || example.Column("Version").Type() != CsvType::Double ||
+        example.Column("Feature").String(1) != "JSON Parsing" || CsvParser().countRows("example.csv") != 3)
+    {
+        std::cerr << "example.csv: unexpected content" << std::endl;
+        return 1;
+    }
+    std::cout << "example.csv: ok" << std::endl;
+
+    // Repeated header names keep their own columns, and numbers that would
+    // not be written back the same way ("00501", "1.50") stay strings.
+    const std::string verbatim = "a,a,b,zip,price\n1,2,3,00501,1.50\n4,5,6,02134,2.25\n";
+    CsvTable verbatimTable = CsvTable::Parse(verbatim);
+    if (verbatimTable.ToCsv() != verbatim || verbatimTable.Column("zip").Type() != CsvType::String ||
+        verbatimTable.Column("b").Type() != CsvType::Int64)
+    {
+        std::cerr << "verbatim: round trip changed the text" << std::endl;
+        return 1;
+    }
+    std::cout << "verbatim: ok" << std::endl;
+
+    const std::size_t columns = 48;
+    std::string text = GenerateCsvCorpus(megabytes * 1024 * 1024, columns, 42);
+    CsvOptions projection;
+    projection.columns = {"col4", "col42"};
+
+    CsvTable reference = CsvTable::Parse(text, CsvOptions(), JsonKernel::Scalar);
+    std::string csv = reference.ToCsv();
+    if (CsvTable::Parse(csv).ToCsv() != csv || CountCsvRows(text) != reference.Rows())
+    {
+        std::cerr << "generated: round trip or row count mismatch" << std::endl;
+        return 1;
+    }
+    std::cout << "generated (" << text.size() / 1024 << " KiB, " << reference.Rows() << " rows x " << columns
+              << " columns)" << std::endl;
+
+    std::vector<JsonKernel> kernels = {JsonKernel::Scalar};
+    if (BestJsonKernel() != JsonKernel::Scalar)
+        kernels.push_back(JsonKernel::Sse2);
+    if (BestJsonKernel() == JsonKernel::Avx2)
+        kernels.push_back(JsonKernel::Avx2);
+
+    for (JsonKernel kernel : kernels)
+    {
+        const int repeats = 3;
+        double seconds[3];
+        bool same = true;
+        CsvTable full;
+        for (int mode = 0; mode < 3; mode++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; r++)
+            {
+                if (mode == 0)
+                    full = CsvTable::Parse(text, CsvOptions(), kernel);
+                else if (mode == 1)
+                    same = same && CsvTable::Parse(text, projection, kernel).Column("col4").Int64Data() ==
+                                       reference.Column("col4").Int64Data();
+                else
+                    same = same && CountCsvRows(text, CsvOptions(), kernel) == reference.Rows();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            seconds[mode] = elapsed.count() / repeats;
+        }
+        if (!same || full.ToCsv() != csv)
+        {
+            std::cerr << "  " << JsonKernelName(kernel) << ": result differs from the scalar kernel" << std::endl;
+            return 1;
+        }
+        double megabytesIn = static_cast<double>(text.size()) / 1e6;
+        std::cout << "  " << JsonKernelName(kernel) << ": all columns " << megabytesIn / seconds[0]
+                  << " MB/s, 2 columns " << megabytesIn / seconds[1]
+                  << " MB/s, row count " << megabytesIn / seconds[2] << " MB/s" << std::endl;
+    }
+    return 0;
+}
+
+// One line per event, for comparing event streams.
+static std::string DumpXmlEvents(XmlReader &reader)
+{
+    static const char *names[] = {"start", "attr", "text", "end", "comment", "pi"};
+    std::string dump;
+    std::string text; // adjacent Text events are merged: chunking may split them
+    while (reader.Next())
+    {
+        if (reader.Event() == XmlEvent::Text)
+        {
+            text += reader.Value();
+            continue;
+        }
+        if (!text.empty())
+            dump += "text " + text + "\n";
+        text.clear();
+        dump += std::string(names[static_cast<int>(reader.Event())]) + " " + std::string(reader.Name()) + " " +
+                std::string(reader.Value()) + "\n";
+    }
+    return dump + (text.empty() ? "" : "text " + text + "\n");
+}
+
+static void AppendXmlRecord(std::string &out, std::uint64_t id)
+{
+    out += "  <record id=\"" + std::to_string(id) + "\" kind='a&amp;b' note=\"x &lt; y\">\n";
+    out += "    <a-rather-long-element-name-that-spans-chunk-boundaries>item &lt;" + std::to_string(id) +
+           "&gt; &#233;&#x1F600;</a-rather-long-element-name-that-spans-chunk-boundaries>\n";
+    out += "    <value>" + std::to_string(id * 7919 % 100003) + "</value>";
+    out += "<![CDATA[raw <data> & stuff]]><!-- comment " + std::to_string(id) + " --><empty flag=\"1\"/>\n";
+    out += "  </record>\n";
+}
+
+static long PeakRssKiB()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Runs measure() in a forked child, so the peak RSS and allocations it
+// reports belong to that run alone, and returns its Result (with peakRssKiB
+// filled in) through a pipe. Returns `failed` if the child throws or dies.
+template <typename Result, typename Measure>
+static Result MeasureInChild(const Result &failed, Measure &&measure)
+{
+    static_assert(std::is_trivially_copyable_v<Result>, "Result is copied through a pipe");
+    int channel[2];
+    if (::pipe(channel) != 0)
+        return failed;
+    pid_t child = ::fork();
+    if (child == 0)
+    {
+        ::close(channel[0]);
+        Result measured = failed;
+        try
+        {
+            measured = measure();
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            ::_exit(1);
+        }
+        measured.peakRssKiB = PeakRssKiB();
+        ssize_t written = ::write(channel[1], &measured, sizeof(measured));
+        ::_exit(written == static_cast<ssize_t>(sizeof(measured)) ? 0 : 1);
+    }
+    ::close(channel[1]);
+    Result result = failed;
+    if (child > 0)
+    {
+        Result measured;
+        if (::read(channel[0], &measured, sizeof(measured)) == static_cast<ssize_t>(sizeof(measured)))
+            result = measured;
+        ::waitpid(child, nullptr, 0);
+    }
+    ::close(channel[0]);
+    return result;
+}
+
+// Scratch directory <temp>/<prefix>-<pid> for generated inputs, removed with
+// its content when the fixture goes out of scope.
+class TempDir
+{
+private:
+    std::filesystem::path dir;
+
+public:
+    explicit TempDir(const std::string &prefix)
+        : dir(std::filesystem::temp_directory_path() / (prefix + "-" + std::to_string(::getpid())))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    TempDir(const TempDir &) = delete;
+    TempDir &operator=(const TempDir &) = delete;
+
+    std::string Path(const std::string &name) const { return (dir / name).string(); }
+
+    // Writes `content` to the file `name` and returns its path.
+    std::string Write(const std::string &name, std::string_view content) const
+    {
+        std::string path = Path(name);
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+};
+
+// Checks that every chunk size yields the same events (names, entities and
+// markup cut at every possible boundary), that parse() reproduces
+// example.xml, then streams a generated file and reports throughput and
+// peak memory.
+static int RunXmlBenchmark(std::size_t megabytes)
+{
+    std::ifstream exampleFile("example.xml", std::ios::binary);
+    std::string example((std::istreambuf_iterator<char>(exampleFile)), std::istreambuf_iterator<char>());
+    if (XmlParser().parse("example.xml").Body() != example)
+    {
+        std::cerr << "example.xml: re-emitted document differs" << std::endl;
+        return 1;
+    }
+    std::cout << "example.xml: ok" << std::endl;
+
+    std::string sample = "<?xml version=\"1.0\"?>\n<!DOCTYPE records [ <!ENTITY x \"y\"> ]>\n<records>\n";
+    for (std::uint64_t id = 0; id < 20; id++)
+        AppendXmlRecord(sample, id);
+    sample += "</records>\n";
+    XmlReader referenceReader(std::string_view(sample), XmlReader::DefaultChunkBytes);
+    std::string reference = DumpXmlEvents(referenceReader);
+    for (std::size_t chunk = 1; chunk <= 200; chunk++)
+    {
+        XmlReader reader(std::string_view(sample), chunk);
+        if (DumpXmlEvents(reader) != reference)
+        {
+            std::cerr << "chunk size " << chunk << ": events differ" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "chunk sizes 1-200: identical events" << std::endl;
+
+    const std::string path = "bench.xml";
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::string piece = "<records>\n";
+        std::uint64_t written = 0;
+        for (std::uint64_t id = 0; written < megabytes * 1024 * 1024; id++)
+        {
+            AppendXmlRecord(piece, id);
+            if (piece.size() > (1 << 20))
+            {
+                out << piece;
+                written += piece.size();
+                piece.clear();
+            }
+        }
+        out << piece << "</records>\n";
+    }
+
+    long rssBefore = PeakRssKiB();
+    std::uint64_t events = 0;
+    std::uint64_t bytes = 0;
+    std::size_t bufferBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        XmlReader reader(path);
+        while (reader.Next())
+            events++;
+        bytes = reader.Offset();
+        bufferBytes = reader.BufferBytes();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::remove(path.c_str());
+
+    std::cout << "streamed " << bytes / (1024 * 1024) << " MiB, " << events << " events: "
+              << static_cast<double>(bytes) / 1e6 / elapsed.count() << " MB/s, buffer " << bufferBytes / 1024
+              << " KiB, peak RSS " << rssBefore / 1024 << " -> " << PeakRssKiB() / 1024 << " MiB" << std::endl;
+    return 0;
+}
+
+// Compares chunk-parallel parsing of one large input with the serial path
+// for CSV (quoted newlines included), NDJSON and plain text, on pools of
+// growing size.
+static int RunSplitBenchmark(std::size_t megabytes)
+{
+    std::size_t bytes = megabytes * 1024 * 1024;
+    const std::string csvPath = "bench-split.csv", ndjsonPath = "bench-split.ndjson", textPath = "bench-split.txt";
+    {
+        std::ofstream(csvPath, std::ios::binary) << GenerateCsvCorpus(bytes, 24, 7);
+        std::ofstream(ndjsonPath, std::ios::binary) << JsonCorpusGenerator(7).Lines(bytes, 4);
+        std::string text;
+        for (std::uint64_t i = 0; text.size() < bytes; i++)
+            text += "line " + std::to_string(i) + (i % 3 ? " of plain text\n" : "\r\n");
+        std::ofstream(textPath, std::ios::binary) << text;
+    }
+
+    auto seconds = [](auto &&run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    CsvTable csvSerial;
+    std::vector<JsonDocument> jsonSerial;
+    TextLines textSerial;
+    textSerial = TextParser().parseLines(csvPath, nullptr); // warm the page cache
+    textSerial = TextParser().parseLines(ndjsonPath, nullptr);
+    double serial[3] = {
+        seconds([&]() { csvSerial = CsvParser().parseTable(csvPath, CsvOptions(), nullptr); }),
+        seconds([&]() { jsonSerial = JsonParser(true).parseLines(ndjsonPath, nullptr); }),
+        seconds([&]() { textSerial = TextParser().parseLines(textPath, nullptr); }),
+    };
+    std::string csvReference = csvSerial.ToCsv();
+    std::cout << "serial: csv " << bytes / 1e6 / serial[0] << " MB/s (" << csvSerial.Rows() << " rows), ndjson "
+              << bytes / 1e6 / serial[1] << " MB/s (" << jsonSerial.size() << " docs), text "
+              << bytes / 1e6 / serial[2] << " MB/s (" << textSerial.Count() << " lines)" << std::endl;
+
+    std::vector<unsigned> threadCounts = {1, 2, 4};
+    if (std::thread::hardware_concurrency() > 4)
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    for (unsigned threads : threadCounts)
+    {
+        WorkStealingPool pool(threads);
+        const std::size_t range = 1024 * 1024; // small ranges: exercise many boundaries
+        CsvTable csv;
+        std::vector<JsonDocument> json;
+        TextLines text;
+        double parallel[3] = {
+            seconds([&]() { csv = CsvTable::ParseParallel(MappedFile::Open(csvPath)->View(), pool, CsvOptions(), range); }),
+            seconds([&]() { json = JsonParser(true).parseLines(ndjsonPath, &pool, range); }),
+            seconds([&]() { text = TextParser().parseLines(textPath, &pool, range); }),
+        };
+        bool same = csv.ToCsv() == csvReference && json.size() == jsonSerial.size() && text.starts == textSerial.starts;
+        for (std::size_t i = 0; same && i < json.size(); i += 97)
+            same = json[i].Serialize(false) == jsonSerial[i].Serialize(false);
+        if (!same)
+        {
+            std::cerr << threads << " threads: result differs from the serial parse" << std::endl;
+            return 1;
+        }
+        std::cout << threads << " threads: csv x" << serial[0] / parallel[0] << ", ndjson x"
+                  << serial[1] / parallel[1] << ", text x" << serial[2] / parallel[2] << std::endl;
+    }
+    std::remove(csvPath.c_str());
+    std::remove(ndjsonPath.c_str());
+    std::remove(textPath.c_str());
+    return 0;
+}
+
+// Lookup cost of the registry against the if/else chain it replaced
+// (string compares in registration order plus one allocation per call), with
+// 60 registered extensions.
+static int RunRegistryBenchmark()
+{
+    FormatRegistry<FileParser> registry;
+    std::vector<std::string> extensions = {"txt", "json", "xml", "csv", "yaml"};
+    for (std::size_t i = extensions.size(); i < 60; i++)
+        extensions.push_back(i % 10 == 0 ? "fmt" + std::to_string(i) + ".gz" : "fmt" + std::to_string(i));
+    auto shared = std::make_shared<TextParser>();
+    for (const std::string &extension : extensions)
+        registry.Register({extension}, shared);
+
+    if (registry.Find("CSV") != shared.get() || registry.Find("gz") != nullptr ||
+        registry.FindForFile("dir.v2/data.fmt10.gz") != shared.get() || registry.FindForFile(".hidden") != nullptr)
+    {
+        std::cerr << "registry: unexpected lookup result" << std::endl;
+        return 1;
+    }
+
+    const int lookups = 2000000;
+    std::size_t hits = 0;
+    for (const std::string &key : {extensions.front(), extensions[30], extensions.back(), std::string("missing")})
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < lookups; i++)
+            hits += registry.Find(key) != nullptr;
+        double registryNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / lookups;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < lookups; i++)
+        {
+            std::unique_ptr<FileParser> parser;
+            for (const std::string &extension : extensions)
+            {
+                if (extension == key)
+                {
+                    parser = std::make_unique<TextParser>();
+                    break;
+                }
+            }
+            hits += parser != nullptr;
+        }
+        double chainNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / lookups;
+        std::cout << key << ": registry " << registryNs << " ns, if/else chain " << chainNs << " ns" << std::endl;
+    }
+    return hits > 0 ? 0 : 1;
+}
+
+// Detection cost against parse cost on a batch of small files of every
+// format, a third each with the right extension, none and a misleading one
+// (".txt" on formats with a Strong content marker, an unregistered one
+// otherwise).
+// Every file must be detected as the format it was written in.
+static int RunSniffBenchmark(std::size_t filesPerFormat)
+{
+    struct Sample
+    {
+        std::string format;
+        std::string content;
+    };
+    std::vector<Sample> samples;
+    std::string json = "{\n  \"records\": [\n";
+    std::string lines;
+    for (int i = 0; i < 20; i++)
+    {
+        json += std::string(i ? ",\n" : "") + "    {\"id\": " + std::to_string(i) + ", \"name\": \"item " + std::to_string(i) + "\"}";
+        lines += "{\"id\": " + std::to_string(i) + ", \"tags\": [\"a\", \"b\"]}\n";
+    }
+    json += "\n  ]\n}\n";
+    std::string xml = "<?xml version=\"1.0\"?>\n<records>\n";
+    for (std::uint64_t id = 0; id < 8; id++)
+        AppendXmlRecord(xml, id);
+    xml += "</records>\n";
+    std::string yaml;
+    for (int i = 0; i < 20; i++)
+        yaml += "key" + std::to_string(i) + ": value " + std::to_string(i) + "\nlist" + std::to_string(i) + ":\n  - a\n  - b\n";
+    std::string text;
+    for (int i = 0; i < 30; i++)
+        text += "Line " + std::to_string(i) + " of a plain text file" + (i % 2 ? ", with a comma.\n" : ".\n");
+    samples.push_back({"json", json});
+    samples.push_back({"ndjson", lines});
+    samples.push_back({"xml", xml});
+    samples.push_back({"csv", GenerateCsvCorpus(8192, 6, 17)});
+    samples.push_back({"yaml", "\xEF\xBB\xBF" + yaml});
+    samples.push_back({"txt", text});
+
+    TempDir dir("sniff-bench");
+    struct Input
+    {
+        std::string path;
+        std::string expected;
+    };
+    std::vector<Input> inputs;
+    for (std::size_t s = 0; s < samples.size(); s++)
+    {
+        for (std::size_t i = 0; i < filesPerFormat; i++)
+        {
+            std::string name = samples[s].format + std::to_string(i);
+            if (i % 3 == 0)
+                name += "." + samples[s].format;
+            else if (i % 3 == 1)
+                name += s < 3 ? std::string(".txt") : "." + samples[s].format.substr(0, 1) + "X";
+            inputs.push_back({dir.Write(name, samples[s].content), samples[s].format});
+        }
+    }
+
+    int status = 0;
+    std::size_t wrong = 0;
+    std::string format;
+    auto start = std::chrono::steady_clock::now();
+    for (const Input &input : inputs)
+    {
+        ParserFactory::detectParser(input.path, &format);
+        wrong += format != input.expected;
+    }
+    double sniffSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::size_t outputBytes = 0;
+    for (const Input &input : inputs)
+        outputBytes += ParserFactory::createParser(input.expected).parse(input.path).Body().size();
+    double parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (wrong > 0)
+    {
+        std::cerr << "sniff: " << wrong << " of " << inputs.size() << " files detected as the wrong format" << std::endl;
+        status = 1;
+    }
+    for (const char *example : {"example.txt", "example.json", "example.xml", "example.csv", "example.yaml"})
+    {
+        if (!std::filesystem::exists(example))
+            continue;
+        ParserFactory::detectParser(example, &format);
+        std::cout << example << ": " << format << std::endl;
+        if (format != getFileExtension(example))
+            status = 1;
+    }
+
+    double files = static_cast<double>(inputs.size());
+    std::cout << std::fixed << std::setprecision(2) << inputs.size() << " files: detect " << sniffSeconds / files * 1e6
+              << " us/file, parse " << parseSeconds / files * 1e6 << " us/file (detection "
+              << std::setprecision(1) << 100 * sniffSeconds / parseSeconds << "% of parse time, " << outputBytes
+              << " bytes parsed)" << std::endl;
+    return status;
+}
+
+// Cold and warm batch runs over generated JSON, CSV and XML files with a
+// cache file in between, then a touched file (same content, new mtime; must
+// hit), an edited file (must miss) and a budget too small for every entry
+// (must evict). Warm results must match the cold ones byte for byte.
+static int RunCacheBenchmark(std::size_t files)
+{
+    TempDir dir("cache-bench");
+    std::string cachePath = dir.Path("parse.cache");
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < files; i++)
+    {
+        std::string content;
+        std::string extension;
+        if (i % 3 == 0)
+        {
+            content = JsonCorpusGenerator(i).Records(64 * 1024, 4);
+            extension = ".json";
+        }
+        else if (i % 3 == 1)
+        {
+            content = GenerateCsvCorpus(64 * 1024, 8, i);
+            extension = ".csv";
+        }
+        else
+        {
+            content = "<records>\n";
+            for (std::uint64_t id = 0; content.size() < 64 * 1024; id++)
+                AppendXmlRecord(content, id);
+            content += "</records>\n";
+            extension = ".xml";
+        }
+        paths.push_back(dir.Write("input" + std::to_string(i) + extension, content));
+    }
+
+    BatchOptions options;
+    options.threads = 1;
+    auto run = [&](ParseCache &cache, std::vector<std::string> &outputs)
+    {
+        options.cache = &cache;
+        outputs.clear();
+        BatchSummary summary = BatchParser::Run(paths, options, [&](BatchFileResult &item)
+        {
+            outputs.push_back(item.result ? item.result->ToString() : "error: " + item.error);
+        });
+        cache.Save();
+        return summary.seconds;
+    };
+
+    int status = 0;
+    std::vector<std::string> coldOutputs;
+    std::vector<std::string> warmOutputs;
+    double coldSeconds = 0;
+    double warmSeconds = 0;
+    {
+        ParseCache cache(cachePath);
+        coldSeconds = run(cache, coldOutputs);
+        PrintCacheStats(cache);
+    }
+    {
+        ParseCache cache(cachePath);
+        warmSeconds = run(cache, warmOutputs);
+        PrintCacheStats(cache);
+        if (warmOutputs != coldOutputs || cache.Stats().hits != files)
+            status = 1;
+    }
+    std::cout << std::fixed << std::setprecision(2) << files << " files: cold " << coldSeconds * 1000 << " ms, warm "
+              << warmSeconds * 1000 << " ms (x" << std::setprecision(1) << coldSeconds / warmSeconds << "), cache file "
+              << std::filesystem::file_size(cachePath) << " bytes" << std::endl;
+
+    // Same content with a new mtime still hits; changed content misses.
+    std::filesystem::last_write_time(paths[0], std::filesystem::last_write_time(paths[0]) + std::chrono::seconds(5));
+    std::ofstream(paths[1], std::ios::app | std::ios::binary) << "1,2,3,4,5,6,7,8\n";
+    {
+        ParseCache cache(cachePath);
+        ParseResult touched = cache.GetOrParse(paths[0], ParseDetected);
+        ParseResult edited = cache.GetOrParse(paths[1], ParseDetected);
+        ParseCacheStats stats = cache.Stats();
+        std::cout << "touched file: " << (stats.hits == 1 ? "hit" : "miss") << ", edited file: "
+                  << (stats.misses == 1 ? "miss" : "hit") << std::endl;
+        if (stats.hits != 1 || stats.misses != 1 || touched.ToString() != coldOutputs[0])
+            status = 1;
+    }
+
+    ParseCacheOptions small;
+    small.budgetBytes = std::filesystem::file_size(cachePath) / 2;
+    {
+        ParseCache cache(cachePath, small);
+        std::vector<std::string> outputs;
+        run(cache, outputs);
+        PrintCacheStats(cache);
+        if (cache.Stats().evictions == 0 || cache.Stats().bytes > small.budgetBytes || outputs.size() != files)
+            status = 1;
+    }
+    if (status != 0)
+        std::cerr << "cache: unexpected result" << std::endl;
+    return status;
+}
+
+// Drops the cached pages of each file (clean pages only, no privileges
+// needed), so the next read goes to the device.
+static void EvictFromPageCache(const std::vector<std::string> &paths)
+{
+    for (const std::string &path : paths)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+}
+
+// Small-file workload: reads (content hash only) and full batch parses of
+// generated 2-16 KB JSON, CSV and text files, synchronously, with the pread
+// pool and with io_uring, from a cold and a warm page cache.
+static int RunAsyncReadBenchmark(std::size_t files)
+{
+    TempDir dir("async-bench");
+    std::vector<std::string> paths;
+    std::uint64_t totalBytes = 0;
+    for (std::size_t i = 0; i < files; i++)
+    {
+        std::size_t bytes = 2048 + (i * 7919) % (14 * 1024);
+        std::string content;
+        std::string extension;
+        if (i % 3 == 0)
+        {
+            content = JsonCorpusGenerator(i).Records(bytes, 3);
+            extension = ".json";
+        }
+        else if (i % 3 == 1)
+        {
+            content = GenerateCsvCorpus(bytes, 6, i);
+            extension = ".csv";
+        }
+        else
+        {
+            while (content.size() < bytes)
+                content += "Line " + std::to_string(content.size()) + " of a small text input.\n";
+            extension = ".txt";
+        }
+        paths.push_back(dir.Write("input" + std::to_string(i) + extension, content));
+        totalBytes += content.size();
+    }
+
+    int status = 0;
+    std::uint64_t expected = 0;
+    auto readSync = [&]()
+    {
+        std::uint64_t sum = 0;
+        for (const std::string &path : paths)
+            sum += HashContent(MappedFile::Open(path)->View());
+        return sum;
+    };
+    auto readAsync = [&](bool useIoUring)
+    {
+        std::uint64_t sum = 0;
+        AsyncFileReader reader(64, useIoUring);
+        reader.ReadAll(paths, [&](LoadedFile &file)
+        {
+            if (!file.error.empty())
+                throw std::runtime_error(file.error);
+            sum += HashContent(file.file->View());
+        });
+        return sum;
+    };
+    auto batch = [&](bool asyncRead)
+    {
+        BatchOptions options;
+        options.asyncRead = asyncRead;
+        std::uint64_t sum = 0;
+        BatchSummary summary = BatchParser::Run(paths, options, [&](BatchFileResult &item)
+        {
+            sum += item.result ? HashContent(item.result->Body()) : 0;
+        });
+        return summary.failed == 0 ? sum : 0;
+    };
+
+    std::cout << files << " files, " << totalBytes / 1024 << " KiB, io_uring "
+              << (AsyncFileReader().ActiveBackend() == AsyncFileReader::Backend::IoUring ? "available" : "unavailable")
+              << std::endl;
+    for (bool cold : {true, false})
+    {
+        struct Mode
+        {
+            const char *name;
+            std::function<std::uint64_t()> run;
+            bool parses;
+        };
+        std::vector<Mode> modes = {
+            {"read   sync mmap ", readSync, false},
+            {"read   pread pool", [&]() { return readAsync(false); }, false},
+            {"read   io_uring  ", [&]() { return readAsync(true); }, false},
+            {"parse  sync      ", [&]() { return batch(false); }, true},
+            {"parse  async     ", [&]() { return batch(true); }, true},
+        };
+        std::uint64_t parsedExpected = 0;
+        for (const Mode &mode : modes)
+        {
+            if (cold)
+                EvictFromPageCache(paths);
+            else
+                mode.run(); // warm up
+            auto start = std::chrono::steady_clock::now();
+            std::uint64_t sum = mode.run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::uint64_t &reference = mode.parses ? parsedExpected : expected;
+            if (reference == 0)
+                reference = sum;
+            if (sum != reference)
+            {
+                std::cerr << mode.name << ": different result" << std::endl;
+                status = 1;
+            }
+            std::cout << (cold ? "cold " : "warm ") << mode.name << ": " << std::fixed << std::setprecision(2)
+                      << seconds * 1000 << " ms, " << std::setprecision(1) << seconds * 1e6 / files << " us/file"
+                      << std::endl;
+        }
+    }
+    return status;
+}
+
+// Deterministic multi-document YAML stream of small service configs, with
+// nested mappings, sequences, flow collections, quoted and block scalars
+// and comments. Document i has "id: i".
+static std::string GenerateYamlStream(std::size_t bytes, std::uint64_t seed)
+{
+    std::uint64_t state = seed;
+    auto next = [&state]()
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<std::uint32_t>(state >> 33);
+    };
+    std::string out;
+    for (std::size_t id = 0; out.size() < bytes; id++)
+    {
+        std::uint32_t r = next();
+        out += "--- # config " + std::to_string(id) + "\n";
+        out += "id: " + std::to_string(id) + "\n";
+        out += "service: svc-" + std::to_string(r % 1000) + "\n";
+        out += "version: \"" + std::to_string(r % 7) + "." + std::to_string(r % 10) + "\"\n";
+        out += "enabled: " + std::string(r % 2 ? "true" : "false") + "\n";
+        out += "labels: [edge, \"zone " + std::to_string(r % 5) + "\", {tier: " + std::to_string(r % 3) + "}]\n";
+        out += "limits:\n  cpu: " + std::to_string(r % 16) + "\n  memory: " + std::to_string(r % 4096) + "Mi\n";
+        out += "endpoints:\n";
+        for (std::uint32_t e = 0; e < 1 + r % 3; e++)
+        {
+            out += "  - host: 'h" + std::to_string(e) + ".example.com'   # primary\n";
+            out += "    port: " + std::to_string(8000 + e) + "\n";
+            out += "    paths:\n    - /api\n    - \"/health\\tcheck\"\n";
+        }
+        if (r % 4 == 0)
+            out += "script: |\n  echo start\n    indented\n\n  echo done\n";
+        out += "note: >-\n  folded text that\n  spans lines\n";
+    }
+    return out;
+}
+
+// Checks example.yaml and a generated stream (every document, a re-parse
+// of the re-emitted text must emit the same), then reports throughput and
+// the arena's heap allocations.
+static int RunYamlBenchmark(std::size_t megabytes)
+{
+    int status = 0;
+    if (std::filesystem::exists("example.yaml"))
+    {
+        auto file = MappedFile::Open("example.yaml");
+        YamlStream stream(file->View());
+        bool ok = stream.Next() && stream.Root()->IsMapping();
+        const YamlNode *features = ok ? stream.Root()->Find("features") : nullptr;
+        const YamlNode *version = ok ? stream.Root()->Find("version") : nullptr;
+        ok = ok && stream.Root()->Find("name")->Value() == "Document Converter" && version && version->quoted &&
+             version->Value() == "1.0" && features && features->IsSequence() && features->Size() == 3 &&
+             features->First()->Value() == "Text Parsing" && !stream.Next();
+        std::cout << "example.yaml: " << (ok ? "ok" : "unexpected tree") << std::endl;
+        if (!ok)
+            status = 1;
+    }
+
+    std::string text = GenerateYamlStream(megabytes * 1024 * 1024, 11);
+    std::string emitted;
+    std::size_t documents = 0;
+    {
+        YamlStream stream(text);
+        while (stream.Next())
+        {
+            const YamlNode *id = stream.Root()->Find("id");
+            const YamlNode *endpoints = stream.Root()->Find("endpoints");
+            if (!id || id->Value() != std::to_string(documents) || !endpoints || endpoints->Size() == 0 ||
+                endpoints->First()->Find("paths")->First()->next->Value() != "/health\tcheck")
+            {
+                std::cerr << "yaml: unexpected tree in document " << documents << std::endl;
+                return 1;
+            }
+            if (documents++ > 0)
+                emitted += "---\n";
+            AppendYaml(emitted, stream.Root());
+        }
+    }
+    std::string again;
+    {
+        YamlStream stream(emitted);
+        while (stream.Next())
+        {
+            if (stream.Documents() > 1)
+                again += "---\n";
+            AppendYaml(again, stream.Root());
+        }
+    }
+    if (again != emitted)
+    {
+        std::cerr << "yaml: re-emitted stream does not round-trip" << std::endl;
+        status = 1;
+    }
+
+    const int rounds = 3;
+    double best = 1e9;
+    std::size_t nodes = 0;
+    std::size_t blocks = 0;
+    std::size_t reserved = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        YamlStream stream(text);
+        while (stream.Next())
+        {
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        nodes = stream.Nodes();
+        blocks = stream.Arena().BlockAllocations();
+        reserved = stream.Arena().BytesReserved();
+    }
+    std::cout << documents << " documents, " << text.size() / 1024 << " KiB: " << std::fixed << std::setprecision(1)
+              << text.size() / 1e6 / best << " MB/s, " << std::setprecision(0) << documents / best
+              << " documents/s; " << nodes << " nodes from " << blocks << " arena block allocation(s), "
+              << reserved / 1024 << " KiB reserved" << std::endl;
+    return status;
+}
+
+// Text of about `bytes` in lines of about `lineLength` characters.
+static std::string GenerateTextCorpus(std::size_t bytes, std::size_t lineLength, std::uint64_t seed)
+{
+    static const char *words[] = {"parser", "factory", "stream", "token", "buffer", "record", "value", "field"};
+    std::uint64_t state = seed;
+    std::string out;
+    out.reserve(bytes + lineLength);
+    std::size_t lineStart = 0;
+    while (out.size() < bytes)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        out += words[(state >> 33) % 8];
+        if (out.size() - lineStart >= lineLength)
+        {
+            out += '\n';
+            lineStart = out.size();
+        }
+        else
+        {
+            out += ' ';
+        }
+    }
+    out += '\n';
+    return out;
+}
+
+// Records nested `depth` elements deep under one root.
+static std::string GenerateDeepXml(std::size_t bytes, int depth)
+{
+    std::string out = "<?xml version=\"1.0\"?>\n<root>\n";
+    for (std::uint64_t id = 0; out.size() < bytes; id++)
+    {
+        for (int level = 0; level < depth; level++)
+            out += "<level n=\"" + std::to_string(level) + "\">";
+        out += "leaf " + std::to_string(id) + " &amp; more";
+        for (int level = 0; level < depth; level++)
+            out += "</level>";
+        out += '\n';
+    }
+    out += "</root>\n";
+    return out;
+}
+
+// Documents of mappings nested `depth` levels deep.
+static std::string GenerateDeepYaml(std::size_t bytes, int depth)
+{
+    std::string out;
+    for (std::uint64_t id = 0; out.size() < bytes; id++)
+    {
+        out += "---\n";
+        for (int level = 0; level < depth; level++)
+        {
+            std::string pad(static_cast<std::size_t>(level) * 2, ' ');
+            out += pad + "name" + std::to_string(level) + ": value " + std::to_string(id) + "\n";
+            out += pad + "level" + std::to_string(level) + ":\n";
+        }
+        out += std::string(static_cast<std::size_t>(depth) * 2, ' ') + "leaf: [1, 2, 3]\n";
+    }
+    return out;
+}
+
+// One measured case of the suite.
+struct SuiteResult
+{
+    char format[16] = {};
+    char shape[16] = {};
+    std::uint64_t bytes = 0;
+    double seconds = 0;         // best round
+    std::uint64_t allocations = 0;
+    std::uint64_t allocatedBytes = 0;
+    long peakRssKiB = 0;        // of the process that ran the case
+    bool ok = false;
+
+    double MegabytesPerSecond() const { return seconds > 0 ? static_cast<double>(bytes) / 1e6 / seconds : 0; }
+};
+
+struct SuiteCase
+{
+    const char *format; // registry key of the parser
+    const char *shape;
+    std::function<std::string(std::size_t)> generate;
+};
+
+static std::vector<SuiteCase> SuiteCases()
+{
+    return {
+        {"txt", "short-lines", [](std::size_t bytes) { return GenerateTextCorpus(bytes, 60, 1); }},
+        {"txt", "long-lines", [](std::size_t bytes) { return GenerateTextCorpus(bytes, 8192, 2); }},
+        {"json", "records", [](std::size_t bytes) { return JsonCorpusGenerator(3).Records(bytes, 4); }},
+        {"json", "deep", [](std::size_t bytes) { return JsonCorpusGenerator(4).Records(bytes, 48); }},
+        {"json", "long-strings", [](std::size_t bytes) { return JsonCorpusGenerator(5).LongStrings(bytes); }},
+        {"ndjson", "records", [](std::size_t bytes) { return JsonCorpusGenerator(6).Lines(bytes, 3); }},
+        {"xml", "records", [](std::size_t bytes)
+         {
+             std::string out = "<records>\n";
+             for (std::uint64_t id = 0; out.size() < bytes; id++)
+                 AppendXmlRecord(out, id);
+             return out + "</records>\n";
+         }},
+        {"xml", "deep", [](std::size_t bytes) { return GenerateDeepXml(bytes, 64); }},
+        {"csv", "narrow", [](std::size_t bytes) { return GenerateCsvCorpus(bytes, 4, 7); }},
+        {"csv", "wide", [](std::size_t bytes) { return GenerateCsvCorpus(bytes, 96, 8); }},
+        {"yaml", "configs", [](std::size_t bytes) { return GenerateYamlStream(bytes, 9); }},
+        {"yaml", "deep", [](std::size_t bytes) { return GenerateDeepYaml(bytes, 32); }},
+    };
+}
+
+// Parses `path` with the format's parser in a forked child, so peak RSS and
+// allocations belong to this case alone; best of `rounds`.
+static SuiteResult RunSuiteCase(const SuiteCase &suiteCase, const std::string &path, int rounds)
+{
+    SuiteResult result;
+    std::snprintf(result.format, sizeof(result.format), "%s", suiteCase.format);
+    std::snprintf(result.shape, sizeof(result.shape), "%s", suiteCase.shape);
+    result.bytes = std::filesystem::file_size(path);
+
+    return MeasureInChild(result, [&]()
+    {
+        SuiteResult measured = result;
+        try
+        {
+            const FileParser &parser = ParserFactory::createParser(suiteCase.format);
+            measured.seconds = 1e9;
+            volatile unsigned consumed = 0;
+            for (int round = 0; round < rounds; round++)
+            {
+                std::uint64_t allocations = heapAllocations.load(std::memory_order_relaxed);
+                std::uint64_t allocated = heapAllocatedBytes.load(std::memory_order_relaxed);
+                auto start = std::chrono::steady_clock::now();
+                ParseResult parsed = parser.parse(path);
+                std::string_view body = parsed.Body();
+                for (std::size_t at = 0; at < body.size(); at += 4096)
+                    consumed += static_cast<unsigned char>(body[at]); // fault in lazily mapped output
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                measured.seconds = std::min(measured.seconds, seconds);
+                if (round == 0)
+                {
+                    measured.allocations = heapAllocations.load(std::memory_order_relaxed) - allocations;
+                    measured.allocatedBytes = heapAllocatedBytes.load(std::memory_order_relaxed) - allocated;
+                }
+                measured.ok = !parsed.Body().empty();
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << suiteCase.format << "/" << suiteCase.shape << ": " << ex.what() << std::endl;
+            measured.ok = false;
+        }
+        return measured;
+    });
+}
+
+static void AppendSuiteResultJson(std::string &out, const SuiteResult &result)
+{
+    out += "    {\"format\": ";
+    AppendJsonString(out, result.format);
+    out += ", \"shape\": ";
+    AppendJsonString(out, result.shape);
+    out += ", \"ok\": " + std::string(result.ok ? "true" : "false");
+    out += ", \"bytes\": " + std::to_string(result.bytes);
+    char number[64];
+    std::snprintf(number, sizeof(number), "%.6f", result.seconds);
+    out += std::string(", \"seconds\": ") + number;
+    std::snprintf(number, sizeof(number), "%.2f", result.MegabytesPerSecond());
+    out += std::string(", \"mbPerSecond\": ") + number;
+    out += ", \"allocations\": " + std::to_string(result.allocations);
+    out += ", \"allocatedBytes\": " + std::to_string(result.allocatedBytes);
+    out += ", \"peakRssKiB\": " + std::to_string(result.peakRssKiB) + "}";
+}
+
+// ParserBench --suite [--size MB] [--rounds N] [--only format[/shape]]
+//                     [--out FILE] [--baseline FILE] [--tolerance PERCENT]
+// Generates every corpus, measures each case in its own process and writes
+// the results as JSON (bench-results.json). With a baseline written by an
+// earlier version, a case that got slower than the tolerance (default 10%)
+// or now fails makes the run fail.
+static int RunBenchmarkSuite(int argc, const char **argv)
+{
+    std::size_t megabytes = 16;
+    int rounds = 3;
+    std::string only;
+    std::string outPath = "bench-results.json";
+    std::string baselinePath;
+    double tolerance = 10;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--size" && i + 1 < argc)
+            megabytes = std::stoul(argv[++i]);
+        else if (option == "--rounds" && i + 1 < argc)
+            rounds = std::max(1, std::stoi(argv[++i]));
+        else if (option == "--only" && i + 1 < argc)
+            only = argv[++i];
+        else if (option == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (option == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (option == "--tolerance" && i + 1 < argc)
+            tolerance = std::stod(argv[++i]);
+    }
+
+    TempDir dir("bench-suite");
+    std::vector<SuiteResult> results;
+    for (const SuiteCase &suiteCase : SuiteCases())
+    {
+        std::string name = std::string(suiteCase.format) + "/" + suiteCase.shape;
+        if (!only.empty() && name != only && only != suiteCase.format)
+            continue;
+        std::string path = dir.Write(std::string(suiteCase.shape) + "." + suiteCase.format,
+                                     suiteCase.generate(megabytes * 1024 * 1024));
+        results.push_back(RunSuiteCase(suiteCase, path, rounds));
+        std::filesystem::remove(path);
+
+        const SuiteResult &result = results.back();
+        std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(9) << result.MegabytesPerSecond() << " MB/s " << std::setw(10) << result.allocations
+                  << " allocs " << std::setw(8) << result.allocatedBytes / (1024 * 1024) << " MiB allocated "
+                  << std::setw(7) << result.peakRssKiB / 1024 << " MiB peak RSS" << (result.ok ? "" : "  FAILED")
+                  << std::endl;
+    }
+
+    std::string json = "{\n  \"version\": 1,\n  \"megabytes\": " + std::to_string(megabytes) +
+                       ",\n  \"rounds\": " + std::to_string(rounds) + ",\n  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        AppendSuiteResultJson(json, results[i]);
+        json += i + 1 < results.size() ? ",\n" : "\n";
+    }
+    json += "  ]\n}\n";
+    std::ofstream(outPath, std::ios::binary) << json;
+    std::cout << "Results saved to '" << outPath << "'." << std::endl;
+
+    int status = 0;
+    for (const SuiteResult &result : results)
+        status |= result.ok ? 0 : 1;
+    if (baselinePath.empty())
+        return status;
+
+    auto baselineFile = MappedFile::Open(baselinePath);
+    JsonDocument baseline = JsonDocument::Parse(baselineFile->View());
+    JsonValue previous = baseline.Root()["results"];
+    for (const SuiteResult &result : results)
+    {
+        for (std::size_t i = 0; i < previous.Size(); i++)
+        {
+            JsonValue entry = previous[i];
+            if (entry["format"].AsString() != result.format || entry["shape"].AsString() != result.shape)
+                continue;
+            double before = entry["mbPerSecond"].AsDouble();
+            double change = before > 0 ? (result.MegabytesPerSecond() - before) / before * 100 : 0;
+            bool regressed = change < -tolerance || (entry["ok"].AsBool() && !result.ok);
+            std::cout << std::left << std::setw(20) << (std::string(result.format) + "/" + result.shape)
+                      << std::right << std::setprecision(1) << std::setw(9) << before << " -> " << std::setw(9)
+                      << result.MegabytesPerSecond() << " MB/s (" << std::showpos << change << std::noshowpos
+                      << "%)" << (regressed ? "  REGRESSION" : "") << std::endl;
+            if (regressed)
+                status = 1;
+        }
+    }
+    return status;
+}
+
+// Parses generated text and JSON inputs (borrowed and generated bodies) and
+// writes the results three ways: one joined string through ofstream (the old
+// output path), WriteTo per result, and OutputWriter. Each way runs in a
+// forked child so its peak RSS is its own; the outputs must be identical.
+static int RunOutputBenchmark(std::size_t megabytes)
+{
+    TempDir dir("output-bench");
+    std::vector<std::string> paths;
+    std::uint64_t inputBytes = 0;
+    const std::size_t files = 16;
+    for (std::size_t i = 0; i < files; i++)
+    {
+        std::size_t bytes = megabytes * 1024 * 1024 / files;
+        bool text = i % 2 == 0;
+        std::string content = text ? GenerateTextCorpus(bytes, 80, i) : JsonCorpusGenerator(i).Records(bytes, 3);
+        paths.push_back(dir.Write("input" + std::to_string(i) + (text ? ".txt" : ".json"), content));
+        inputBytes += content.size();
+    }
+
+    struct Measured
+    {
+        double seconds = 0;
+        long peakRssKiB = 0;
+        std::uint64_t writes = 0;
+    };
+    auto measure = [&](int mode, const std::string &outPath)
+    {
+        return MeasureInChild(Measured(), [&]()
+        {
+            Measured measured;
+            auto start = std::chrono::steady_clock::now();
+            if (mode == 0)
+            {
+                std::string joined;
+                for (const std::string &path : paths)
+                    joined += ParseDetected(path).ToString() + "\n";
+                std::ofstream out(outPath, std::ios::binary);
+                out << joined;
+            }
+            else if (mode == 1)
+            {
+                std::ofstream out(outPath, std::ios::binary);
+                for (const std::string &path : paths)
+                {
+                    ParseDetected(path).WriteTo(out);
+                    out << '\n';
+                }
+            }
+            else
+            {
+                OutputWriter output(outPath);
+                for (const std::string &path : paths)
+                    output.Append(ParseDetected(path), "\n");
+                output.Commit();
+                measured.writes = output.WriteCalls();
+            }
+            measured.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return measured;
+        });
+    };
+
+    std::cout << files << " files, " << inputBytes / 1024 << " KiB of input" << std::endl;
+    const char *names[] = {"ofstream joined ", "ofstream WriteTo ", "OutputWriter     "};
+    std::uint64_t hashes[3] = {};
+    int status = 0;
+    for (int mode = 0; mode < 3; mode++)
+    {
+        std::string outPath = dir.Path("output" + std::to_string(mode) + ".txt");
+        measure(mode, outPath); // warm up
+        Measured measured = measure(mode, outPath);
+        // Only a hash is kept: memory held here would count in the next child's RSS.
+        auto output = MappedFile::Open(outPath);
+        hashes[mode] = HashContent(output->View());
+        bool same = hashes[mode] == hashes[0];
+        if (!same || measured.seconds == 0)
+            status = 1;
+        std::cout << names[mode] << std::fixed << std::setprecision(1) << std::setw(8)
+                  << output->View().size() / 1e6 / measured.seconds << " MB/s, peak RSS " << std::setw(7)
+                  << measured.peakRssKiB / 1024 << " MiB";
+        if (mode == 2)
+            std::cout << ", " << measured.writes << " writev call(s)";
+        std::cout << (same ? "" : "  OUTPUT DIFFERS") << std::endl;
+    }
+    return status;
+}
+
+// ParserBench --json|--csv|--xml|--split|--yaml|--output [MB]
+// ParserBench --registry | --sniff [files per format] | --cache [files] | --async [files]
+// ParserBench --suite [options]
+int main(int argc, const char **argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--json")
+    {
+        return RunJsonBenchmark(argc > 2 ? std::stoul(argv[2]) : 16);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--csv")
+    {
+        return RunCsvBenchmark(argc > 2 ? std::stoul(argv[2]) : 16);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--xml")
+    {
+        return RunXmlBenchmark(argc > 2 ? std::stoul(argv[2]) : 256);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--split")
+    {
+        return RunSplitBenchmark(argc > 2 ? std::stoul(argv[2]) : 64);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--registry")
+    {
+        return RunRegistryBenchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--sniff")
+    {
+        return RunSniffBenchmark(argc > 2 ? std::stoul(argv[2]) : 300);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--cache")
+    {
+        return RunCacheBenchmark(argc > 2 ? std::stoul(argv[2]) : 60);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--async")
+    {
+        return RunAsyncReadBenchmark(argc > 2 ? std::stoul(argv[2]) : 3000);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--yaml")
+    {
+        return RunYamlBenchmark(argc > 2 ? std::stoul(argv[2]) : 16);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--output")
+    {
+        return RunOutputBenchmark(argc > 2 ? std::stoul(argv[2]) : 64);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--suite")
+    {
+        return RunBenchmarkSuite(argc, argv);
+    }
+
+    std::cerr << "usage: " << (argc > 0 ? argv[0] : "ParserBench")
+              << " --json|--csv|--xml|--split|--yaml|--output [MB] | --registry | --sniff [N] | --cache [N]"
+              << " | --async [N] | --suite [options]" << std::endl;
+    return 1;
+}
@@ -0,0 +1,116 @@
+#ifndef TYPE_LIST_FACTORY_HPP
+#define TYPE_LIST_FACTORY_HPP
+
+/*
+Factory over a set of product types fixed at compile time.
+
+    using Devices = TypeList<LedDevice, BuzzerDevice>;
+    TypeListFactory<Devices>::Value led = TypeListFactory<Devices>::Make<LedDevice>();
+    auto any = TypeListFactory<Devices>::Make(index);           // chosen at run time
+    std::visit([](auto &device) { device.TurnOn(); }, any);     // no vtable
+
+Value is a std::variant of the listed types: the product lives inline (no
+heap allocation) and std::visit calls the concrete member function, which
+the compiler can inline. A run-time index (e.g. an enum value) selects the
+type through a table generated from the list instead of an if/else chain.
+
+MakeUnique<Interface, Adapter>(index) builds the same product boxed as
+Adapter<T>, a class implementing Interface, for code that still works with
+polymorphic objects; types outside the list (plugins) keep implementing
+Interface directly.
+*/
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+template <typename... Types>
+struct TypeList
+{
+    static constexpr std::size_t Size = sizeof...(Types);
+};
+
+// Position of T in a TypeList; does not compile when T is missing.
+template <typename T, typename List>
+struct IndexOf;
+
+template <typename T, typename... Rest>
+struct IndexOf<T, TypeList<T, Rest...>> : std::integral_constant<std::size_t, 0>
+{
+};
+
+template <typename T, typename First, typename... Rest>
+struct IndexOf<T, TypeList<First, Rest...>>
+    : std::integral_constant<std::size_t, 1 + IndexOf<T, TypeList<Rest...>>::value>
+{
+};
+
+template <typename List>
+class TypeListFactory;
+
+template <typename... Types>
+class TypeListFactory<TypeList<Types...>>
+{
+public:
+    using List = TypeList<Types...>;
+    using Value = std::variant<Types...>;
+
+    static constexpr std::size_t Size = sizeof...(Types);
+
+    template <typename T>
+    static constexpr std::size_t Index = IndexOf<T, List>::value;
+
+    template <typename T, typename... Args>
+    static Value Make(Args &&...args)
+    {
+        return Value(std::in_place_index<Index<T>>, std::forward<Args>(args)...);
+    }
+
+    // The default-constructed type at `index` in the list.
+    static Value Make(std::size_t index)
+    {
+        static constexpr std::array<Value (*)(), Size> makers = {&MakeDefault<Types>...};
+        if (index >= Size)
+            throw std::out_of_range("TypeListFactory: no type at index " + std::to_string(index));
+        return makers[index]();
+    }
+
+    // The type at `index`, boxed as Adapter<T> behind Interface.
+    template <typename Interface, template <typename> class Adapter>
+    static std::unique_ptr<Interface> MakeUnique(std::size_t index)
+    {
+        static constexpr std::array<std::unique_ptr<Interface> (*)(), Size> makers = {
+            &MakeBoxed<Interface, Adapter, Types>...};
+        if (index >= Size)
+            throw std::out_of_range("TypeListFactory: no type at index " + std::to_string(index));
+        return makers[index]();
+    }
+
+    // Calls f(T*) once per listed type, in list order (the pointer is null;
+    // it only carries the type).
+    template <typename F>
+    static void ForEachType(F &&f)
+    {
+        (f(static_cast<Types *>(nullptr)), ...);
+    }
+
+private:
+    template <typename T>
+    static Value MakeDefault()
+    {
+        return Value(std::in_place_index<Index<T>>);
+    }
+
+    template <typename Interface, template <typename> class Adapter, typename T>
+    static std::unique_ptr<Interface> MakeBoxed()
+    {
+        static_assert(std::is_base_of_v<Interface, Adapter<T>>, "Adapter<T> must implement Interface");
+        return std::make_unique<Adapter<T>>();
+    }
+};
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+/*
+Fixed-size thread pool with one task deque per worker.
+
+A worker takes its own newest task first (LIFO, cache warm) and, when its
+deque is empty, steals the oldest task of another worker (FIFO), so a few
+large tasks on one worker do not leave the others idle. Tasks submitted from
+outside the pool are dealt round robin; tasks submitted from a worker go to
+that worker's own deque. Idle workers sleep on a condition variable.
+
+ParallelFor(count, body) runs body(0..count-1) as tasks and returns when all
+are done; the waiting thread runs queued tasks itself meanwhile, so it may be
+called from inside a task without starving the pool.
+
+The destructor runs every task already submitted, then joins the workers.
+*/
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::size_t queued = 0; // tasks in all deques, guarded by sleepMutex
+    bool stopping = false;
+    std::atomic<std::size_t> nextWorker{0};
+    std::atomic<std::uint64_t> steals{0};
+
+    static inline thread_local WorkStealingPool *currentPool = nullptr;
+    static inline thread_local std::size_t currentWorker = 0;
+
+    bool TakeTask(std::size_t self, std::function<void()> &task)
+    {
+        if (self < workers.size())
+        {
+            Worker &own = *workers[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i <= workers.size(); i++)
+        {
+            Worker &victim = *workers[(self + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Loop(std::size_t self)
+    {
+        currentPool = this;
+        currentWorker = self;
+        std::function<void()> task;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wake.wait(lock, [this]() { return stopping || queued > 0; });
+                if (queued == 0)
+                    return; // stopping and drained
+                queued--;   // claim one task; it is in some deque
+            }
+            while (!TakeTask(self, task))
+                std::this_thread::yield(); // claimed task is being pushed right now
+            task();
+            task = nullptr;
+        }
+    }
+
+public:
+    explicit WorkStealingPool(unsigned threadCount = std::thread::hardware_concurrency())
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+        for (unsigned i = 0; i < threadCount; i++)
+            workers.push_back(std::make_unique<Worker>());
+        for (unsigned i = 0; i < threadCount; i++)
+            threads.emplace_back(&WorkStealingPool::Loop, this, i);
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    void Submit(std::function<void()> task)
+    {
+        std::size_t target = currentPool == this ? currentWorker
+                                                 : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        {
+            Worker &worker = *workers[target];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // Claims and runs one queued task on the calling thread, if there is one.
+    bool RunPendingTask()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            if (queued == 0)
+                return false;
+            queued--;
+        }
+        std::size_t self = currentPool == this ? currentWorker : workers.size();
+        std::function<void()> task;
+        while (!TakeTask(self, task))
+            std::this_thread::yield();
+        task();
+        return true;
+    }
+
+    // Runs body(i) for every i in [0, count) on the pool and waits for all of
+    // them. The first exception thrown by a body is rethrown here.
+    template <typename Body>
+    void ParallelFor(std::size_t count, Body &&body)
+    {
+        std::mutex doneMutex;
+        std::condition_variable allDone;
+        std::size_t remaining = count;
+        std::exception_ptr failure;
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Submit([&, i]()
+            {
+                try
+                {
+                    body(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    if (!failure)
+                        failure = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (--remaining == 0)
+                    allDone.notify_all();
+            });
+        }
+
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (remaining == 0)
+                    break;
+            }
+            if (RunPendingTask())
+                continue;
+            std::unique_lock<std::mutex> lock(doneMutex);
+            allDone.wait(lock, [&]() { return remaining == 0; });
+        }
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+
+    std::size_t ThreadCount() const { return threads.size(); }
+    std::uint64_t Steals() const { return steals.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,557 @@
+#ifndef XML_READER_HPP
+#define XML_READER_HPP
+
+/*
+Streaming pull parser for XML, used by XmlParser.
+
+The file is read with read(2) in fixed-size chunks into one buffer, so memory
+stays flat no matter how large the input is. Each Next() produces one event:
+
+    StartElement   Name() = tag, then one Attribute event per attribute
+    Attribute      Name() = attribute, Value() = decoded value
+    Text           Value() = decoded character data (CDATA included)
+    EndElement     Name() = tag; also sent right after a self-closing start
+    Comment        Value() = comment body
+    Instruction    Name() = target, Value() = the rest, e.g. the <?xml ...?> line
+
+Markup (a tag, comment or instruction) is always delivered whole: when it
+runs past the end of the buffer, the unread part is moved to the front and
+the next chunk is appended, growing the buffer only for markup larger than a
+chunk (up to MaxMarkupBytes). Long text is delivered in several Text events
+instead, split only where no entity reference is cut in half. Name() and
+Value() stay valid until the next call to Next().
+
+    XmlReader reader("example.xml");
+    while (reader.Next())
+        if (reader.Event() == XmlEvent::StartElement) ...
+*/
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "JsonDocument.hpp" // HexValue, AppendUtf8
+
+enum class XmlEvent : char
+{
+    StartElement,
+    Attribute,
+    Text,
+    EndElement,
+    Comment,
+    Instruction
+};
+
+class XmlReader
+{
+private:
+    int fd;
+    std::string_view memory; // input when reading from memory instead of a file
+    std::size_t chunkBytes;
+    std::vector<char> buffer;
+    std::size_t start = 0; // unread window is buffer[start, end)
+    std::size_t end = 0;
+    std::uint64_t consumed = 0; // input offset of buffer[start]
+    bool eof = false;
+
+    XmlEvent event = XmlEvent::Text;
+    std::string_view name;
+    std::string_view value;
+    std::string valueScratch;
+
+    struct PendingAttribute
+    {
+        std::string name;
+        std::string value;
+    };
+    std::vector<PendingAttribute> attributes; // of the last start tag, reused
+    std::size_t attributeCount = 0;
+    std::size_t nextAttribute = 0;
+    bool pendingSelfClose = false;
+
+    std::vector<std::string> open; // names of the open elements, reused
+    std::size_t depth = 0;
+    std::string closedName;
+    bool sawRoot = false;
+
+    [[noreturn]] void Fail(std::size_t relative, const std::string &what) const
+    {
+        throw std::runtime_error("Invalid XML at offset " + std::to_string(consumed + relative) + ": " + what);
+    }
+
+    std::size_t Available() const { return end - start; }
+    const char *Data() const { return buffer.data() + start; }
+
+    void Consume(std::size_t bytes)
+    {
+        start += bytes;
+        consumed += bytes;
+    }
+
+    // Appends the next chunk after the unread window, which moves to the
+    // front first; relative offsets stay valid. Returns false at end of input.
+    bool Fill()
+    {
+        if (eof)
+            return false;
+        if (start > 0)
+        {
+            std::memmove(buffer.data(), buffer.data() + start, end - start);
+            end -= start;
+            start = 0;
+        }
+        if (buffer.size() - end < chunkBytes)
+        {
+            if (end > MaxMarkupBytes)
+                Fail(0, "markup larger than " + std::to_string(MaxMarkupBytes) + " bytes");
+            buffer.resize(end + chunkBytes);
+        }
+
+        if (fd < 0)
+        {
+            std::size_t count = std::min(chunkBytes, memory.size());
+            std::memcpy(buffer.data() + end, memory.data(), count);
+            memory.remove_prefix(count);
+            end += count;
+            eof = memory.empty();
+            return count > 0;
+        }
+
+        for (;;)
+        {
+            ssize_t count = ::read(fd, buffer.data() + end, chunkBytes);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count < 0)
+                throw std::runtime_error("Cannot read XML input");
+            if (count == 0)
+            {
+                eof = true;
+                return false;
+            }
+            end += static_cast<std::size_t>(count);
+            return true;
+        }
+    }
+
+    // Relative offset of `pattern` at or after `from`, reading more input
+    // as needed; npos if the input ends first.
+    std::size_t Find(std::string_view pattern, std::size_t from)
+    {
+        for (;;)
+        {
+            std::size_t at = std::string_view(Data(), Available()).find(pattern, from);
+            if (at != std::string_view::npos)
+                return at;
+            if (Available() >= pattern.size())
+                from = std::max(from, Available() - pattern.size() + 1);
+            if (!Fill())
+                return std::string_view::npos;
+        }
+    }
+
+    // Relative offset of the '>' closing a tag, skipping quoted values.
+    std::size_t FindTagEnd()
+    {
+        std::size_t i = 1;
+        char quote = 0;
+        for (;;)
+        {
+            for (; i < Available(); i++)
+            {
+                char c = Data()[i];
+                if (quote)
+                {
+                    if (c == quote)
+                        quote = 0;
+                }
+                else if (c == '"' || c == '\'')
+                    quote = c;
+                else if (c == '>')
+                    return i;
+            }
+            if (!Fill())
+                Fail(0, "unterminated tag");
+        }
+    }
+
+    static bool IsNameChar(char c)
+    {
+        return !(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' || c == '>' || c == '=' ||
+                 c == '"' || c == '\'' || c == '<');
+    }
+    static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    // Decodes entity and character references of `raw` into `out`.
+    void Decode(std::string_view raw, std::size_t relative, std::string &out) const
+    {
+        out.clear();
+        std::size_t i = 0;
+        while (i < raw.size())
+        {
+            std::size_t amp = raw.find('&', i);
+            if (amp == std::string_view::npos)
+            {
+                out.append(raw.data() + i, raw.size() - i);
+                break;
+            }
+            out.append(raw.data() + i, amp - i);
+            std::size_t semicolon = raw.find(';', amp);
+            if (semicolon == std::string_view::npos)
+                Fail(relative + amp, "unterminated entity reference");
+            std::string_view entity = raw.substr(amp + 1, semicolon - amp - 1);
+            if (entity == "lt")
+                out += '<';
+            else if (entity == "gt")
+                out += '>';
+            else if (entity == "amp")
+                out += '&';
+            else if (entity == "quot")
+                out += '"';
+            else if (entity == "apos")
+                out += '\'';
+            else if (entity.size() > 1 && entity[0] == '#')
+            {
+                bool hex = entity[1] == 'x';
+                std::string_view digits = entity.substr(hex ? 2 : 1);
+                std::uint32_t codePoint = 0;
+                for (char c : digits)
+                {
+                    int digit = HexValue(c);
+                    if (digit < 0 || (!hex && digit > 9) || codePoint > 0x10ffff)
+                        Fail(relative + amp, "bad character reference");
+                    codePoint = codePoint * (hex ? 16 : 10) + static_cast<std::uint32_t>(digit);
+                }
+                if (digits.empty() || codePoint > 0x10ffff)
+                    Fail(relative + amp, "bad character reference");
+                AppendUtf8(out, codePoint);
+            }
+            else
+                Fail(relative + amp, "unknown entity &" + std::string(entity) + ";");
+            i = semicolon + 1;
+        }
+    }
+
+    std::string_view Decoded(std::string_view raw, std::size_t relative, std::string &scratch) const
+    {
+        if (raw.find('&') == std::string_view::npos)
+            return raw;
+        Decode(raw, relative, scratch);
+        return scratch;
+    }
+
+    void ReadText()
+    {
+        std::size_t from = 0;
+        std::size_t length;
+        for (;;)
+        {
+            const void *lt = std::memchr(Data() + from, '<', Available() - from);
+            if (lt)
+            {
+                length = static_cast<std::size_t>(static_cast<const char *>(lt) - Data());
+                break;
+            }
+            from = Available();
+            // Merge text across chunks while the window is below one chunk;
+            // beyond that, hand out what is there.
+            if (Available() < chunkBytes && Fill())
+                continue;
+            length = Available();
+            if (!eof)
+            {
+                // Do not cut an entity reference in half.
+                std::string_view window(Data(), length);
+                std::size_t amp = window.rfind('&');
+                if (amp != std::string_view::npos && window.find(';', amp) == std::string_view::npos)
+                    length = amp;
+                if (length == 0)
+                {
+                    Fill();
+                    continue;
+                }
+            }
+            break;
+        }
+
+        event = XmlEvent::Text;
+        name = std::string_view();
+        value = Decoded(std::string_view(Data(), length), 0, valueScratch);
+        if (depth == 0 && value.find_first_not_of(" \t\r\n") != std::string_view::npos)
+            Fail(0, "text outside the root element");
+        Consume(length);
+    }
+
+    // Buffer-relative markup starting with "<!" or "<?".
+    bool ReadSpecial()
+    {
+        while (Available() < 9 && Fill())
+        {
+        }
+        std::string_view head(Data(), std::min<std::size_t>(Available(), 9));
+        if (head.substr(0, 4) == "<!--")
+        {
+            std::size_t close = Find("-->", 4);
+            if (close == std::string_view::npos)
+                Fail(0, "unterminated comment");
+            event = XmlEvent::Comment;
+            name = std::string_view();
+            value = std::string_view(Data() + 4, close - 4);
+            Consume(close + 3);
+            return true;
+        }
+        if (head.substr(0, 9) == "<![CDATA[")
+        {
+            if (depth == 0)
+                Fail(0, "CDATA outside the root element");
+            std::size_t close = Find("]]>", 9);
+            if (close == std::string_view::npos)
+                Fail(0, "unterminated CDATA section");
+            event = XmlEvent::Text;
+            name = std::string_view();
+            value = std::string_view(Data() + 9, close - 9);
+            Consume(close + 3);
+            return true;
+        }
+        if (head.substr(0, 2) == "<?")
+        {
+            std::size_t close = Find("?>", 2);
+            if (close == std::string_view::npos)
+                Fail(0, "unterminated processing instruction");
+            std::string_view body(Data() + 2, close - 2);
+            std::size_t nameEnd = 0;
+            while (nameEnd < body.size() && !IsSpace(body[nameEnd]))
+                nameEnd++;
+            std::size_t valueStart = nameEnd;
+            while (valueStart < body.size() && IsSpace(body[valueStart]))
+                valueStart++;
+            event = XmlEvent::Instruction;
+            name = body.substr(0, nameEnd);
+            value = body.substr(valueStart);
+            Consume(close + 2);
+            return true;
+        }
+        // <!DOCTYPE ...>, possibly with an internal [ ... ] subset: skipped.
+        std::size_t i = 2;
+        int brackets = 0;
+        for (;;)
+        {
+            for (; i < Available(); i++)
+            {
+                char c = Data()[i];
+                if (c == '[')
+                    brackets++;
+                else if (c == ']')
+                    brackets--;
+                else if (c == '>' && brackets == 0)
+                {
+                    Consume(i + 1);
+                    return Next();
+                }
+            }
+            if (!Fill())
+                Fail(0, "unterminated declaration");
+        }
+    }
+
+    bool ReadEndTag()
+    {
+        std::size_t close = FindTagEnd();
+        std::string_view tag(Data() + 2, close - 2);
+        while (!tag.empty() && IsSpace(tag.back()))
+            tag.remove_suffix(1);
+        if (depth == 0 || tag != open[depth - 1])
+            Fail(0, "unexpected </" + std::string(tag) + ">");
+        closedName.swap(open[--depth]);
+        event = XmlEvent::EndElement;
+        name = closedName;
+        value = std::string_view();
+        Consume(close + 1);
+        return true;
+    }
+
+    bool ReadStartTag()
+    {
+        std::size_t close = FindTagEnd();
+        std::string_view tag(Data(), close);
+        bool selfClosing = tag.back() == '/';
+        if (selfClosing)
+            tag.remove_suffix(1);
+
+        std::size_t i = 1;
+        while (i < tag.size() && IsNameChar(tag[i]))
+            i++;
+        if (i == 1)
+            Fail(0, "missing element name");
+        if (depth == 0 && sawRoot)
+            Fail(0, "more than one root element");
+        sawRoot = true;
+        if (open.size() == depth)
+            open.emplace_back();
+        open[depth].assign(tag.data() + 1, i - 1);
+
+        attributeCount = 0;
+        for (;;)
+        {
+            while (i < tag.size() && IsSpace(tag[i]))
+                i++;
+            if (i == tag.size())
+                break;
+            std::size_t nameStart = i;
+            while (i < tag.size() && IsNameChar(tag[i]))
+                i++;
+            std::size_t nameEnd = i;
+            while (i < tag.size() && IsSpace(tag[i]))
+                i++;
+            if (nameEnd == nameStart || i == tag.size() || tag[i] != '=')
+                Fail(i, "malformed attribute");
+            i++;
+            while (i < tag.size() && IsSpace(tag[i]))
+                i++;
+            if (i == tag.size() || (tag[i] != '"' && tag[i] != '\''))
+                Fail(i, "attribute value must be quoted");
+            std::size_t valueEnd = tag.find(tag[i], i + 1);
+            if (valueEnd == std::string_view::npos)
+                Fail(i, "unterminated attribute value");
+
+            if (attributes.size() == attributeCount)
+                attributes.emplace_back();
+            PendingAttribute &attribute = attributes[attributeCount++];
+            attribute.name.assign(tag.data() + nameStart, nameEnd - nameStart);
+            Decode(tag.substr(i + 1, valueEnd - i - 1), i + 1, attribute.value);
+            i = valueEnd + 1;
+        }
+
+        event = XmlEvent::StartElement;
+        name = open[depth++];
+        value = std::string_view();
+        nextAttribute = 0;
+        pendingSelfClose = selfClosing;
+        Consume(close + 1);
+        return true;
+    }
+
+public:
+    static const std::size_t DefaultChunkBytes = 64 * 1024;
+    static const std::size_t MaxMarkupBytes = 16 * 1024 * 1024;
+
+    explicit XmlReader(const std::string &FilePath, std::size_t chunkBytes = DefaultChunkBytes)
+        : fd(::open(FilePath.c_str(), O_RDONLY)), chunkBytes(chunkBytes), buffer(chunkBytes)
+    {
+        if (fd < 0)
+            throw std::runtime_error("Cannot open file: " + FilePath);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    // Reads from memory, still chunk by chunk (useful for testing boundaries).
+    XmlReader(std::string_view text, std::size_t chunkBytes)
+        : fd(-1), memory(text), chunkBytes(chunkBytes), buffer(chunkBytes), eof(text.empty()) {}
+
+    ~XmlReader()
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    XmlReader(const XmlReader &) = delete;
+    XmlReader &operator=(const XmlReader &) = delete;
+
+    // Advances to the next event; false once the document has ended.
+    bool Next()
+    {
+        if (nextAttribute < attributeCount)
+        {
+            const PendingAttribute &attribute = attributes[nextAttribute++];
+            event = XmlEvent::Attribute;
+            name = attribute.name;
+            value = attribute.value;
+            return true;
+        }
+        attributeCount = nextAttribute = 0;
+        if (pendingSelfClose)
+        {
+            pendingSelfClose = false;
+            closedName.swap(open[--depth]);
+            event = XmlEvent::EndElement;
+            name = closedName;
+            value = std::string_view();
+            return true;
+        }
+
+        if (consumed == 0)
+        {
+            while (Available() < 3 && Fill())
+            {
+            }
+            if (Available() >= 3 && std::memcmp(Data(), "\xEF\xBB\xBF", 3) == 0)
+                Consume(3); // UTF-8 byte order mark
+        }
+        if (Available() == 0 && !Fill())
+        {
+            if (depth > 0)
+                Fail(0, "unclosed element <" + open[depth - 1] + ">");
+            if (!sawRoot)
+                Fail(0, "no root element");
+            return false;
+        }
+        if (Data()[0] != '<')
+        {
+            ReadText();
+            return true;
+        }
+        while (Available() < 2 && Fill())
+        {
+        }
+        if (Available() < 2)
+            Fail(0, "unterminated tag");
+        char second = Data()[1];
+        if (second == '!' || second == '?')
+            return ReadSpecial();
+        if (second == '/')
+            return ReadEndTag();
+        return ReadStartTag();
+    }
+
+    XmlEvent Event() const { return event; }
+    std::string_view Name() const { return name; }
+    std::string_view Value() const { return value; }
+    std::size_t Depth() const { return depth; } // open elements after this event
+    std::uint64_t Offset() const { return consumed; } // input bytes consumed
+    std::size_t BufferBytes() const { return buffer.size(); }
+};
+
+// Escapes text or attribute content for re-emitting it as XML.
+inline void AppendXmlEscaped(std::string &out, std::string_view text, bool attribute)
+{
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '<':
+            out += "&lt;";
+            break;
+        case '>':
+            out += "&gt;";
+            break;
+        case '&':
+            out += "&amp;";
+            break;
+        case '"':
+            if (attribute)
+            {
+                out += "&quot;";
+                break;
+            }
+            out += c;
+            break;
+        default:
+            out += c;
+        }
+    }
+}
+
+#endif
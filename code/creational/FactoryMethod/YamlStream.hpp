@@ -0,0 +1,844 @@
+#ifndef YAML_STREAM_HPP
+#define YAML_STREAM_HPP
+
+/*
+Parser for the YAML subset that configuration files use, one document at a
+time:
+
+    block mappings      key: value, key:\n  nested, "quoted key": value
+    block sequences     - item, - key: value (compact), key:\n- item
+    scalars             plain (multi-line plain is folded), 'single',
+                        "double" with escapes, |, > with - and + chomping
+    flow collections    [a, b], {a: 1, b: [x]} on one line
+    comments            # to the end of the line
+    documents           ---, ..., %directives; several per stream
+
+Anchors, aliases, tags and complex keys are rejected.
+
+Nodes live in a YamlArena that the stream resets before each document, so
+parsing a document allocates nothing once the arena has grown to the size of
+the largest document: nodes are bump-allocated and never destroyed one by
+one. Scalars that need no decoding are views into the input text, which must
+outlive the stream; the nodes of a document stay valid until the next call
+to Next().
+
+    YamlStream stream(text);
+    while (stream.Next())
+        use(stream.Root()); // Root()->Find("name")->Value()
+*/
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "JsonDocument.hpp" // HexValue, AppendUtf8
+
+// Bump allocator made of blocks that are kept across Reset().
+class YamlArena
+{
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size = 0;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t current = 0; // block being filled
+    std::size_t used = 0;    // bytes used in it
+    std::size_t blockAllocations = 0;
+
+public:
+    static constexpr std::size_t BlockBytes = 64 * 1024;
+
+    void *Allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t))
+    {
+        for (;;)
+        {
+            if (current < blocks.size())
+            {
+                std::size_t start = (used + align - 1) & ~(align - 1);
+                if (start + bytes <= blocks[current].size)
+                {
+                    used = start + bytes;
+                    return blocks[current].data.get() + start;
+                }
+                current++;
+                used = 0;
+                continue;
+            }
+            Block block;
+            block.size = std::max(BlockBytes, bytes + align);
+            block.data.reset(new char[block.size]);
+            blocks.push_back(std::move(block));
+            blockAllocations++;
+        }
+    }
+
+    std::string_view Copy(std::string_view text)
+    {
+        if (text.empty())
+            return std::string_view();
+        char *copy = static_cast<char *>(Allocate(text.size(), 1));
+        std::memcpy(copy, text.data(), text.size());
+        return std::string_view(copy, text.size());
+    }
+
+    // Makes all memory reusable; everything allocated before is invalid.
+    void Reset()
+    {
+        current = 0;
+        used = 0;
+    }
+
+    std::size_t BytesReserved() const
+    {
+        std::size_t total = 0;
+        for (const Block &block : blocks)
+            total += block.size;
+        return total;
+    }
+    std::size_t BlockAllocations() const { return blockAllocations; } // heap allocations so far
+};
+
+enum class YamlKind : unsigned char
+{
+    Null,
+    Scalar,
+    Mapping,
+    Sequence
+};
+
+// A node of a parsed document. Children of a mapping or sequence form a
+// singly linked list; a mapping child carries its key.
+struct YamlNode
+{
+    YamlKind kind = YamlKind::Null;
+    bool quoted = false;   // scalar was written quoted (so "1.0" stays a string)
+    std::string_view key;  // set on mapping entries
+    std::string_view value;
+    YamlNode *first = nullptr;
+    YamlNode *last = nullptr;
+    YamlNode *next = nullptr;
+    std::size_t size = 0;
+
+    bool IsNull() const { return kind == YamlKind::Null; }
+    bool IsScalar() const { return kind == YamlKind::Scalar; }
+    bool IsMapping() const { return kind == YamlKind::Mapping; }
+    bool IsSequence() const { return kind == YamlKind::Sequence; }
+    std::string_view Key() const { return key; }
+    std::string_view Value() const { return value; }
+    std::size_t Size() const { return size; }
+    const YamlNode *First() const { return first; }
+    const YamlNode *Next() const { return next; }
+
+    // Value of `name` in a mapping, or nullptr.
+    const YamlNode *Find(std::string_view name) const
+    {
+        for (const YamlNode *child = first; child; child = child->next)
+        {
+            if (child->key == name)
+                return child;
+        }
+        return nullptr;
+    }
+};
+
+class YamlStream
+{
+private:
+    std::string_view text;
+    YamlArena arena;
+    std::string scratch; // decoding buffer, reused
+    YamlNode *root = nullptr;
+    std::size_t documents = 0;
+    std::size_t nodes = 0;
+
+    // Raw position: start of the next line not yet looked at.
+    std::size_t pos = 0;
+    std::size_t nextLineNumber = 1;
+
+    // Current significant line (not blank, not only a comment).
+    bool hasLine = false;
+    int indent = 0;
+    std::string_view content; // after the indentation, comment and trailing blanks removed
+    std::size_t lineNumber = 0;
+
+    [[noreturn]] void Fail(const std::string &what, std::size_t line = 0) const
+    {
+        throw std::runtime_error("Invalid YAML at line " + std::to_string(line ? line : lineNumber) + ": " + what);
+    }
+
+    static bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+    static std::string_view TrimRight(std::string_view s)
+    {
+        while (!s.empty() && (IsBlank(s.back()) || s.back() == '\r'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    static std::string_view TrimLeft(std::string_view s)
+    {
+        while (!s.empty() && IsBlank(s.front()))
+            s.remove_prefix(1);
+        return s;
+    }
+
+    // The raw line at `at` (without its line end) and where the next starts.
+    std::string_view RawLine(std::size_t at, std::size_t &nextStart) const
+    {
+        std::size_t end = text.find('\n', at);
+        if (end == std::string_view::npos)
+            end = text.size();
+        nextStart = end < text.size() ? end + 1 : end;
+        std::string_view line = text.substr(at, end - at);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        return line;
+    }
+
+    static bool IsMarker(std::string_view line, const char *marker)
+    {
+        return line.substr(0, 3) == marker && (line.size() == 3 || IsBlank(line[3]));
+    }
+
+    // Cuts a comment: '#' at the start or after a blank, outside quotes.
+    static std::string_view StripComment(std::string_view s)
+    {
+        char quote = 0;
+        for (std::size_t i = 0; i < s.size(); i++)
+        {
+            char c = s[i];
+            if (quote)
+            {
+                if (c == '\\' && quote == '"')
+                    i++;
+                else if (c == quote)
+                    quote = 0;
+            }
+            else if ((c == '"' || c == '\'') && (i == 0 || std::strchr(" \t:-[{,", s[i - 1])))
+            {
+                quote = c;
+            }
+            else if (c == '#' && (i == 0 || IsBlank(s[i - 1])))
+            {
+                return TrimRight(s.substr(0, i));
+            }
+        }
+        return TrimRight(s);
+    }
+
+    // Moves to the next significant line of the document; at a document
+    // marker or the end of the text there is none (and pos stays put).
+    void LoadLine()
+    {
+        hasLine = false;
+        while (pos < text.size())
+        {
+            std::size_t nextStart = 0;
+            std::string_view raw = RawLine(pos, nextStart);
+            if (IsMarker(raw, "---") || IsMarker(raw, "..."))
+                return;
+            std::size_t lineNo = nextLineNumber++;
+            pos = nextStart;
+
+            std::size_t spaces = 0;
+            while (spaces < raw.size() && raw[spaces] == ' ')
+                spaces++;
+            std::string_view rest = StripComment(raw.substr(spaces));
+            if (TrimLeft(rest).empty())
+                continue;
+            if (rest.front() == '\t')
+                Fail("tab in indentation", lineNo);
+            hasLine = true;
+            indent = static_cast<int>(spaces);
+            content = rest;
+            lineNumber = lineNo;
+            return;
+        }
+    }
+
+    YamlNode *NewNode(YamlKind kind)
+    {
+        nodes++;
+        YamlNode *node = new (arena.Allocate(sizeof(YamlNode), alignof(YamlNode))) YamlNode();
+        node->kind = kind;
+        return node;
+    }
+
+    static void Append(YamlNode *parent, YamlNode *child)
+    {
+        if (parent->last)
+            parent->last->next = child;
+        else
+            parent->first = child;
+        parent->last = child;
+        parent->size++;
+    }
+
+    static bool IsSequenceEntry(std::string_view s) { return !s.empty() && s[0] == '-' && (s.size() == 1 || s[1] == ' '); }
+
+    static bool IsNullWord(std::string_view s) { return s.empty() || s == "~" || s == "null" || s == "Null" || s == "NULL"; }
+
+    // End of a quoted scalar starting at s[0], or npos if unterminated.
+    static std::size_t QuotedEnd(std::string_view s)
+    {
+        char quote = s[0];
+        for (std::size_t i = 1; i < s.size(); i++)
+        {
+            if (quote == '"' && s[i] == '\\')
+                i++;
+            else if (s[i] == quote)
+            {
+                if (quote == '\'' && i + 1 < s.size() && s[i + 1] == '\'')
+                    i++; // '' is an escaped quote
+                else
+                    return i + 1;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // Offset of the ':' that ends a mapping key on the line, or npos.
+    static std::size_t MappingColon(std::string_view s)
+    {
+        std::size_t i = 0;
+        if (s[0] == '"' || s[0] == '\'')
+        {
+            i = QuotedEnd(s);
+            if (i == std::string_view::npos)
+                return i;
+            while (i < s.size() && IsBlank(s[i]))
+                i++;
+            return i < s.size() && s[i] == ':' && (i + 1 == s.size() || IsBlank(s[i + 1])) ? i : std::string_view::npos;
+        }
+        if (s[0] == '[' || s[0] == '{')
+            return std::string_view::npos;
+        for (; i < s.size(); i++)
+        {
+            if (s[i] == ':' && (i + 1 == s.size() || IsBlank(s[i + 1])))
+                return i;
+        }
+        return std::string_view::npos;
+    }
+
+    // Decodes a quoted scalar (quotes included); a view when nothing needs
+    // decoding, else a copy in the arena.
+    std::string_view Unquote(std::string_view quoted)
+    {
+        std::string_view body = quoted.substr(1, quoted.size() - 2);
+        char quote = quoted[0];
+        if (body.find(quote == '"' ? '\\' : '\'') == std::string_view::npos)
+            return body;
+        scratch.clear();
+        for (std::size_t i = 0; i < body.size(); i++)
+        {
+            char c = body[i];
+            if (quote == '\'')
+            {
+                scratch += c;
+                if (c == '\'')
+                    i++; // second quote of ''
+                continue;
+            }
+            if (c != '\\')
+            {
+                scratch += c;
+                continue;
+            }
+            if (++i >= body.size())
+                Fail("bad escape");
+            switch (body[i])
+            {
+            case 'n': scratch += '\n'; break;
+            case 't': scratch += '\t'; break;
+            case 'r': scratch += '\r'; break;
+            case '0': scratch += '\0'; break;
+            case 'b': scratch += '\b'; break;
+            case 'f': scratch += '\f'; break;
+            case 'e': scratch += '\x1b'; break;
+            case '"': scratch += '"'; break;
+            case '/': scratch += '/'; break;
+            case '\\': scratch += '\\'; break;
+            case ' ': scratch += ' '; break;
+            case 'x':
+            case 'u':
+            case 'U':
+            {
+                std::size_t digits = body[i] == 'x' ? 2 : body[i] == 'u' ? 4 : 8;
+                std::uint32_t codePoint = 0;
+                for (std::size_t d = 0; d < digits; d++)
+                {
+                    int value = i + 1 + d < body.size() ? HexValue(body[i + 1 + d]) : -1;
+                    if (value < 0)
+                        Fail("bad escape");
+                    codePoint = codePoint * 16 + static_cast<std::uint32_t>(value);
+                }
+                i += digits;
+                AppendUtf8(scratch, codePoint);
+                break;
+            }
+            default:
+                Fail("bad escape");
+            }
+        }
+        return arena.Copy(scratch);
+    }
+
+    YamlNode *Scalar(std::string_view value, bool quoted)
+    {
+        if (!quoted && IsNullWord(value))
+            return NewNode(YamlKind::Null);
+        YamlNode *node = NewNode(YamlKind::Scalar);
+        node->value = value;
+        node->quoted = quoted;
+        return node;
+    }
+
+    static void RejectUnsupported(std::string_view s)
+    {
+        if (!s.empty() && (s[0] == '&' || s[0] == '*' || s[0] == '!' || s[0] == '?'))
+            throw std::runtime_error(std::string("unsupported YAML feature: ") + s[0]);
+    }
+
+    // Flow collection or scalar inside [...] / {...}, starting at s[i].
+    YamlNode *ParseFlow(std::string_view s, std::size_t &i)
+    {
+        while (i < s.size() && IsBlank(s[i]))
+            i++;
+        if (i == s.size())
+            Fail("unterminated flow collection");
+        char c = s[i];
+        if (c == '[' || c == '{')
+        {
+            bool mapping = c == '{';
+            char close = mapping ? '}' : ']';
+            YamlNode *node = NewNode(mapping ? YamlKind::Mapping : YamlKind::Sequence);
+            i++;
+            for (;;)
+            {
+                while (i < s.size() && IsBlank(s[i]))
+                    i++;
+                if (i < s.size() && s[i] == close)
+                {
+                    i++;
+                    return node;
+                }
+                std::string_view key;
+                if (mapping)
+                {
+                    YamlNode *keyNode = ParseFlow(s, i);
+                    if (keyNode->IsMapping() || keyNode->IsSequence())
+                        Fail("complex mapping key");
+                    key = keyNode->value;
+                    while (i < s.size() && IsBlank(s[i]))
+                        i++;
+                    if (i == s.size() || s[i] != ':')
+                        Fail("expected ':' in flow mapping");
+                    i++;
+                }
+                YamlNode *value = ParseFlow(s, i);
+                value->key = key;
+                Append(node, value);
+                while (i < s.size() && IsBlank(s[i]))
+                    i++;
+                if (i < s.size() && s[i] == ',')
+                    i++;
+                else if (i == s.size() || s[i] != close)
+                    Fail("expected ',' or closing bracket");
+            }
+        }
+        if (c == '"' || c == '\'')
+        {
+            std::size_t end = QuotedEnd(s.substr(i));
+            if (end == std::string_view::npos)
+                Fail("unterminated quoted scalar");
+            std::string_view quoted = s.substr(i, end);
+            i += end;
+            return Scalar(Unquote(quoted), true);
+        }
+        RejectUnsupported(s.substr(i));
+        std::size_t start = i;
+        while (i < s.size() && s[i] != ',' && s[i] != ']' && s[i] != '}' &&
+               !(s[i] == ':' && (i + 1 == s.size() || std::strchr(" ,]}", s[i + 1]))))
+            i++;
+        return Scalar(TrimRight(s.substr(start, i - start)), false);
+    }
+
+    // | or > block scalar whose header `header` ends the current line; the
+    // content is every following line indented deeper than `ownerIndent`.
+    YamlNode *ParseBlockScalar(std::string_view header, int ownerIndent)
+    {
+        bool folded = header[0] == '>';
+        char chomp = header.size() > 1 ? header[1] : 0;
+        if (header.size() > 2 || (chomp && chomp != '-' && chomp != '+'))
+            Fail("unsupported block scalar header");
+
+        scratch.clear();
+        std::size_t contentIndent = 0;
+        std::size_t pendingNewlines = 0; // blank lines not yet written
+        bool any = false;
+        bool lastMoreIndented = false;
+        while (pos < text.size())
+        {
+            std::size_t nextStart = 0;
+            std::string_view raw = RawLine(pos, nextStart);
+            if (IsMarker(raw, "---") || IsMarker(raw, "..."))
+                break;
+            std::size_t spaces = 0;
+            while (spaces < raw.size() && raw[spaces] == ' ')
+                spaces++;
+            if (spaces == raw.size())
+            {
+                pendingNewlines++;
+                pos = nextStart;
+                nextLineNumber++;
+                continue;
+            }
+            if (!any)
+            {
+                if (static_cast<int>(spaces) <= ownerIndent)
+                    break;
+                contentIndent = spaces;
+            }
+            else if (spaces < contentIndent)
+            {
+                break;
+            }
+            std::string_view line = raw.substr(contentIndent);
+            bool moreIndented = spaces > contentIndent;
+            if (any)
+            {
+                if (!folded || moreIndented || lastMoreIndented)
+                    scratch.append(pendingNewlines + 1, '\n');
+                else if (pendingNewlines > 0)
+                    scratch.append(pendingNewlines, '\n');
+                else
+                    scratch += ' ';
+            }
+            else
+            {
+                scratch.append(pendingNewlines, '\n');
+            }
+            scratch += line;
+            pendingNewlines = 0;
+            any = true;
+            lastMoreIndented = moreIndented;
+            pos = nextStart;
+            nextLineNumber++;
+        }
+        if (any && chomp != '-')
+            scratch += '\n';
+        if (chomp == '+')
+            scratch.append(pendingNewlines, '\n');
+
+        YamlNode *node = NewNode(YamlKind::Scalar);
+        node->value = arena.Copy(scratch);
+        node->quoted = true; // never null, never re-read as a number
+        LoadLine();
+        return node;
+    }
+
+    // A value written after "key:" or "- " on the current line; consumes
+    // the line (and any continuation lines of a plain scalar).
+    YamlNode *ParseInline(std::string_view s, int ownerIndent)
+    {
+        RejectUnsupported(s);
+        if (s[0] == '|' || s[0] == '>')
+            return ParseBlockScalar(s, ownerIndent);
+        if (s[0] == '[' || s[0] == '{')
+        {
+            std::size_t i = 0;
+            YamlNode *node = ParseFlow(s, i);
+            if (!TrimLeft(s.substr(i)).empty())
+                Fail("unexpected text after flow collection");
+            LoadLine();
+            return node;
+        }
+        if (s[0] == '"' || s[0] == '\'')
+        {
+            std::size_t end = QuotedEnd(s);
+            if (end == std::string_view::npos)
+                Fail("unterminated quoted scalar (multi-line quoted scalars are not supported)");
+            if (!TrimLeft(s.substr(end)).empty())
+                Fail("unexpected text after quoted scalar");
+            YamlNode *node = Scalar(Unquote(s), true);
+            LoadLine();
+            return node;
+        }
+
+        std::size_t startLine = lineNumber;
+        LoadLine();
+        if (!hasLine || indent <= ownerIndent)
+            return Scalar(s, false);
+        scratch.assign(s); // multi-line plain scalar: lines are folded with spaces
+        while (hasLine && indent > ownerIndent)
+        {
+            if (MappingColon(content) != std::string_view::npos && content[0] != '"' && content[0] != '\'')
+                Fail("mapping inside a plain scalar", startLine);
+            scratch += ' ';
+            scratch += content;
+            LoadLine();
+        }
+        return Scalar(arena.Copy(scratch), false);
+    }
+
+    YamlNode *ParseSequence(int seqIndent)
+    {
+        YamlNode *node = NewNode(YamlKind::Sequence);
+        while (hasLine && indent == seqIndent && IsSequenceEntry(content))
+        {
+            std::string_view rest = TrimLeft(content.substr(1));
+            YamlNode *item;
+            if (rest.empty())
+            {
+                LoadLine();
+                item = ParseBlock(seqIndent);
+            }
+            else
+            {
+                // Re-read the rest of the line as if it started a block at
+                // its own column: "- a: 1" then "  b: 2" is one mapping.
+                indent += static_cast<int>(content.size() - rest.size());
+                content = rest;
+                item = ParseBlock(seqIndent);
+            }
+            Append(node, item);
+        }
+        return node;
+    }
+
+    YamlNode *ParseMapping(int mapIndent)
+    {
+        YamlNode *node = NewNode(YamlKind::Mapping);
+        while (hasLine && indent == mapIndent)
+        {
+            std::size_t colon = MappingColon(content);
+            if (colon == std::string_view::npos)
+                Fail(IsSequenceEntry(content) ? "sequence entry inside a mapping" : "expected 'key: value'");
+            std::string_view rawKey = TrimRight(content.substr(0, colon));
+            RejectUnsupported(rawKey);
+            std::string_view key = rawKey[0] == '"' || rawKey[0] == '\'' ? Unquote(rawKey) : rawKey;
+            std::string_view rest = TrimLeft(content.substr(colon + 1));
+
+            YamlNode *value;
+            if (rest.empty())
+            {
+                LoadLine();
+                if (hasLine && indent == mapIndent && IsSequenceEntry(content))
+                    value = ParseSequence(mapIndent); // "key:\n- item" at the key's column
+                else
+                    value = ParseBlock(mapIndent);
+            }
+            else
+            {
+                value = ParseInline(rest, mapIndent);
+            }
+            value->key = key;
+            Append(node, value);
+        }
+        if (hasLine && indent > mapIndent)
+            Fail("bad indentation");
+        return node;
+    }
+
+    // The block that starts on the current line, if it is indented deeper
+    // than its parent; otherwise a null value.
+    YamlNode *ParseBlock(int parentIndent)
+    {
+        if (!hasLine || indent <= parentIndent)
+            return NewNode(YamlKind::Null);
+        if (IsSequenceEntry(content))
+            return ParseSequence(indent);
+        if (MappingColon(content) != std::string_view::npos)
+            return ParseMapping(indent);
+        return ParseInline(content, parentIndent);
+    }
+
+public:
+    explicit YamlStream(std::string_view text) : text(text)
+    {
+        if (this->text.substr(0, 3) == "\xEF\xBB\xBF")
+            pos = 3; // UTF-8 byte order mark
+    }
+
+    YamlStream(const YamlStream &) = delete;
+    YamlStream &operator=(const YamlStream &) = delete;
+
+    // Parses the next document; false at the end of the stream. The nodes
+    // of the previous document are released (the arena is reset).
+    bool Next()
+    {
+        arena.Reset();
+        root = nullptr;
+        std::string_view inlineRoot;
+        bool explicitStart = false;
+        while (pos < text.size())
+        {
+            std::size_t nextStart = 0;
+            std::string_view raw = RawLine(pos, nextStart);
+            std::string_view stripped = StripComment(raw);
+            if (IsMarker(raw, "---"))
+            {
+                pos = nextStart;
+                nextLineNumber++;
+                explicitStart = true;
+                inlineRoot = TrimLeft(StripComment(raw.substr(3)));
+                lineNumber = nextLineNumber - 1;
+                break;
+            }
+            if (IsMarker(raw, "...") || TrimLeft(stripped).empty() || (!raw.empty() && raw[0] == '%'))
+            {
+                pos = nextStart; // document end, blank, comment or directive
+                nextLineNumber++;
+                continue;
+            }
+            break; // content: a document without "---"
+        }
+        if (pos >= text.size() && !explicitStart)
+            return false;
+
+        try
+        {
+            if (!inlineRoot.empty())
+            {
+                hasLine = true;
+                content = inlineRoot;
+                indent = -1;
+                root = ParseInline(inlineRoot, -1);
+            }
+            else
+            {
+                LoadLine();
+                root = ParseBlock(-1);
+            }
+        }
+        catch (const std::runtime_error &ex)
+        {
+            std::string what = ex.what();
+            if (what.rfind("Invalid YAML", 0) == 0)
+                throw;
+            Fail(what);
+        }
+        if (hasLine)
+            Fail("bad indentation");
+        documents++;
+        return true;
+    }
+
+    const YamlNode *Root() const { return root; }
+    std::size_t Documents() const { return documents; } // parsed so far
+    std::size_t Nodes() const { return nodes; }         // allocated so far, all documents
+    const YamlArena &Arena() const { return arena; }
+};
+
+// Scalars are written plain when they read back the same, else double-quoted.
+inline void AppendYamlScalar(std::string &out, std::string_view value, bool quoted)
+{
+    bool plain = !quoted && !value.empty() && value.find(": ") == std::string_view::npos &&
+                 value.find(" #") == std::string_view::npos && value.back() != ':' && value.back() != ' ' &&
+                 value != "~" && value != "null" && value != "Null" && value != "NULL";
+    if (plain && std::strchr("-?:,[]{}#&*!|>'\"%@` \t", value[0]))
+        plain = value[0] == '-' && value.size() > 1 && value[1] != ' '; // "-1", "-flag"
+    for (char c : value)
+        plain = plain && static_cast<unsigned char>(c) >= 0x20 && c != 0x7f;
+    if (plain)
+    {
+        out += value;
+        return;
+    }
+    static const char Hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value)
+    {
+        unsigned char u = static_cast<unsigned char>(c);
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        case '\r': out += "\\r"; break;
+        default:
+            if (u < 0x20 || u == 0x7f)
+            {
+                out += "\\x";
+                out += Hex[u >> 4];
+                out += Hex[u & 15];
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+// Block-style YAML for one document. `indent` is the column of the node's
+// entries; with `inlineFirst` the first entry continues a "- " already written.
+inline void AppendYaml(std::string &out, const YamlNode *node, int indent = 0, bool inlineFirst = false)
+{
+    auto inlineValue = [](const YamlNode *value)
+    {
+        return value->IsScalar() || value->IsNull() || value->Size() == 0;
+    };
+    auto appendInline = [&](const YamlNode *value)
+    {
+        if (value->IsNull())
+            out += "null";
+        else if (value->IsScalar())
+            AppendYamlScalar(out, value->Value(), value->quoted);
+        else
+            out += value->IsMapping() ? "{}" : "[]";
+    };
+
+    if (inlineValue(node))
+    {
+        appendInline(node);
+        out += '\n';
+        return;
+    }
+    bool firstEntry = true;
+    for (const YamlNode *child = node->First(); child; child = child->Next())
+    {
+        if (!(firstEntry && inlineFirst))
+            out.append(static_cast<std::size_t>(indent), ' ');
+        firstEntry = false;
+        if (node->IsSequence())
+        {
+            out += "- ";
+            if (inlineValue(child))
+            {
+                appendInline(child);
+                out += '\n';
+            }
+            else
+            {
+                AppendYaml(out, child, indent + 2, true);
+            }
+            continue;
+        }
+        AppendYamlScalar(out, child->Key(), false);
+        out += ':';
+        if (inlineValue(child))
+        {
+            out += ' ';
+            appendInline(child);
+            out += '\n';
+        }
+        else
+        {
+            out += '\n';
+            AppendYaml(out, child, indent + 2);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef LOG_COMPRESSION_HPP
+#define LOG_COMPRESSION_HPP
+
+/*
+Small self-contained LZ77 compressor for rotated log segments, in the spirit
+of LZ4: repeated timestamps, levels and messages make logs compress well with
+a plain hash-table match finder and no entropy coding.
+
+A compressed segment (.lz) is the 8 byte LogCompressedMagic followed by
+blocks of at most LogCompressionBlockSize input bytes:
+
+    uint32 rawSize | uint32 compressedSize | compressedSize bytes
+
+Each block is a run of sequences:
+
+    token | [literal length bytes] | literals | uint16 offset | [match length bytes]
+
+The token's high nibble is the literal length and its low nibble the match
+length minus LogMinMatch; a nibble of 15 continues in following bytes that are
+added up until one is below 255. The last sequence of a block has literals
+only, no offset.
+*/
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+const char LogCompressedMagic[8] = {'L', 'Z', 'L', 'O', 'G', '0', '1', '\n'};
+const std::size_t LogCompressionBlockSize = 1 << 20;
+const std::size_t LogMinMatch = 4;
+
+inline void AppendLength(std::string &out, std::size_t length)
+{
+    while (length >= 255)
+    {
+        out += static_cast<char>(255);
+        length -= 255;
+    }
+    out += static_cast<char>(length);
+}
+
+inline void AppendSequence(std::string &out, const char *literals, std::size_t literalLength,
+                           std::size_t offset, std::size_t matchLength)
+{
+    std::size_t matchCode = matchLength >= LogMinMatch ? matchLength - LogMinMatch : 0;
+    std::uint8_t token = static_cast<std::uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+    if (offset != 0)
+    {
+        token |= static_cast<std::uint8_t>(matchCode < 15 ? matchCode : 15);
+    }
+    out += static_cast<char>(token);
+    if (literalLength >= 15)
+    {
+        AppendLength(out, literalLength - 15);
+    }
+    out.append(literals, literalLength);
+    if (offset != 0)
+    {
+        out += static_cast<char>(offset & 0xff);
+        out += static_cast<char>(offset >> 8);
+        if (matchCode >= 15)
+        {
+            AppendLength(out, matchCode - 15);
+        }
+    }
+}
+
+// Compresses one block (at most LogCompressionBlockSize bytes) and appends it to `out`.
+inline void CompressBlock(std::string &out, const char *data, std::size_t size)
+{
+    const std::size_t HashBits = 16;
+    std::vector<std::uint32_t> table(std::size_t(1) << HashBits, 0xffffffffu);
+
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    while (pos + LogMinMatch <= size)
+    {
+        std::uint32_t sequence;
+        std::memcpy(&sequence, data + pos, sizeof(sequence));
+        std::uint32_t hash = (sequence * 2654435761u) >> (32 - HashBits);
+        std::uint32_t candidate = table[hash];
+        table[hash] = static_cast<std::uint32_t>(pos);
+
+        if (candidate != 0xffffffffu && pos - candidate <= 0xffff &&
+            std::memcmp(data + candidate, data + pos, LogMinMatch) == 0)
+        {
+            std::size_t length = LogMinMatch;
+            while (pos + length < size && data[candidate + length] == data[pos + length])
+            {
+                length++;
+            }
+            AppendSequence(out, data + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+        }
+        else
+        {
+            pos++;
+        }
+    }
+    AppendSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+inline std::size_t ReadLength(const std::uint8_t *&in, const std::uint8_t *end)
+{
+    std::size_t length = 0;
+    std::uint8_t byte;
+    do
+    {
+        if (in >= end)
+            throw std::runtime_error("Corrupt compressed log block");
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+inline void DecompressBlock(std::string &out, const char *data, std::size_t size, std::size_t rawSize)
+{
+    const std::uint8_t *in = reinterpret_cast<const std::uint8_t *>(data);
+    const std::uint8_t *end = in + size;
+    std::size_t start = out.size();
+
+    while (in < end)
+    {
+        std::uint8_t token = *in++;
+        std::size_t literalLength = token >> 4;
+        if (literalLength == 15)
+            literalLength += ReadLength(in, end);
+        if (static_cast<std::size_t>(end - in) < literalLength)
+            throw std::runtime_error("Corrupt compressed log block");
+        out.append(reinterpret_cast<const char *>(in), literalLength);
+        in += literalLength;
+
+        if (in == end)
+            break; // last sequence has literals only
+
+        if (end - in < 2)
+            throw std::runtime_error("Corrupt compressed log block");
+        std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+        in += 2;
+        std::size_t matchLength = token & 0x0f;
+        if (matchLength == 15)
+            matchLength += ReadLength(in, end);
+        matchLength += LogMinMatch;
+
+        if (offset == 0 || offset > out.size() - start)
+            throw std::runtime_error("Corrupt compressed log block");
+        std::size_t from = out.size() - offset;
+        for (std::size_t i = 0; i < matchLength; i++)
+        {
+            out += out[from + i]; // byte by byte: matches may overlap themselves
+        }
+    }
+
+    if (out.size() - start != rawSize)
+        throw std::runtime_error("Corrupt compressed log block");
+}
+
+// Stream-to-stream helpers used for whole segments.
+inline void CompressStream(std::istream &in, std::ostream &out)
+{
+    out.write(LogCompressedMagic, sizeof(LogCompressedMagic));
+
+    std::vector<char> raw(LogCompressionBlockSize);
+    std::string compressed;
+    while (in.read(raw.data(), static_cast<std::streamsize>(raw.size())) || in.gcount() > 0)
+    {
+        std::uint32_t rawSize = static_cast<std::uint32_t>(in.gcount());
+        compressed.clear();
+        CompressBlock(compressed, raw.data(), rawSize);
+        std::uint32_t compressedSize = static_cast<std::uint32_t>(compressed.size());
+        out.write(reinterpret_cast<const char *>(&rawSize), sizeof(rawSize));
+        out.write(reinterpret_cast<const char *>(&compressedSize), sizeof(compressedSize));
+        out.write(compressed.data(), compressedSize);
+    }
+}
+
+inline std::string DecompressStream(std::istream &in)
+{
+    char magic[sizeof(LogCompressedMagic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, LogCompressedMagic, sizeof(magic)) != 0)
+        throw std::runtime_error("Not a compressed log segment");
+
+    std::string out;
+    std::string compressed;
+    std::uint32_t sizes[2];
+    while (in.read(reinterpret_cast<char *>(sizes), sizeof(sizes)))
+    {
+        compressed.resize(sizes[1]);
+        if (!in.read(&compressed[0], sizes[1]))
+            throw std::runtime_error("Truncated compressed log segment");
+        DecompressBlock(out, compressed.data(), compressed.size(), sizes[0]);
+    }
+    return out;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+Offline decoder for the binary logs written by Logger in binary mode.
+Turns Application.blog back into the usual text lines:
+
+    [YYYY-MM-DD HH:MM:SS] [Level] message
+
+Compressed rotated segments (.lz) are expanded first, so this also reads
+"Application.log.<stamp>.lz" text segments.
+
+usage: LogDecoder <file.blog | segment.lz> [--ms | --us] [--thread]
+*/
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include "LogFormat.hpp"
+#include "LogCompression.hpp"
+
+struct DecoderOptions
+{
+    int fractionDigits = 0; // 0, 3 or 6
+    bool showThread = false;
+};
+
+static void PrintRecord(std::ostream &out, const BinaryRecordHeader &header,
+                        const std::string &message, const DecoderOptions &options)
+{
+    std::int64_t seconds = header.ticks / 1000000000;
+    std::int64_t nanos = header.ticks % 1000000000;
+    if (nanos < 0)
+    {
+        seconds--;
+        nanos += 1000000000;
+    }
+
+    std::time_t second = static_cast<std::time_t>(seconds);
+    std::tm localTime;
+    localtime_r(&second, &localTime);
+
+    out << "[" << std::put_time(&localTime, "%Y-%m-%d %H:%M:%S");
+    if (options.fractionDigits == 3)
+    {
+        out << "." << std::setw(3) << std::setfill('0') << nanos / 1000000;
+    }
+    else if (options.fractionDigits == 6)
+    {
+        out << "." << std::setw(6) << std::setfill('0') << nanos / 1000;
+    }
+    out << "] ";
+    if (options.showThread)
+    {
+        out << "[" << std::hex << header.threadId << std::dec << "] ";
+    }
+    out << "[" << LevelName(static_cast<LogLevel>(header.level)) << "] " << message << '\n';
+}
+
+static void DecodeRecords(std::istream &in, const std::string &path, const DecoderOptions &options)
+{
+    BinaryRecordHeader header;
+    std::string message;
+    while (in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        message.resize(header.length);
+        if (!in.read(&message[0], header.length))
+        {
+            throw std::runtime_error("Truncated record in: " + path);
+        }
+        PrintRecord(std::cout, header, message, options);
+    }
+}
+
+static void DecodeFile(const std::string &path, const DecoderOptions &options)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open file: " + path);
+
+    std::istringstream expanded;
+    std::istream *in = &file;
+    char magic[sizeof(BinaryLogMagic)];
+    if (file.read(magic, sizeof(magic)) && std::memcmp(magic, LogCompressedMagic, sizeof(magic)) == 0)
+    {
+        file.seekg(0);
+        expanded.str(DecompressStream(file));
+        in = &expanded;
+        in->read(magic, sizeof(magic));
+    }
+
+    if (in->gcount() == sizeof(magic) && std::memcmp(magic, BinaryLogMagic, sizeof(magic)) == 0)
+    {
+        DecodeRecords(*in, path, options);
+        return;
+    }
+
+    // Plain text segment: already in the final format.
+    in->clear();
+    in->seekg(0);
+    std::cout << in->rdbuf();
+}
+
+int main(int argc, const char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <file.blog> [--ms | --us] [--thread]" << std::endl;
+        return 1;
+    }
+
+    DecoderOptions options;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--ms")
+            options.fractionDigits = 3;
+        else if (option == "--us")
+            options.fractionDigits = 6;
+        else if (option == "--thread")
+            options.showThread = true;
+    }
+
+    try
+    {
+        DecodeFile(argv[1], options);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+/*
+On-disk layout shared by Logger.cpp (writer) and LogDecoder.cpp (reader).
+
+A binary log (.blog) starts with an 8 byte file header and is followed by
+records, each one a fixed BinaryRecordHeader and `length` raw message bytes.
+Fields are stored in host byte order; the decoder runs on the same machine
+class that wrote the log.
+*/
+#include <cstdint>
+
+enum class LogLevel : unsigned char
+{
+    Info,
+    Warning,
+    Error
+};
+
+inline const char *LevelName(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Info:
+        return "Info";
+    case LogLevel::Warning:
+        return "Warning";
+    case LogLevel::Error:
+        return "Error";
+    }
+    return "Unknown";
+}
+
+// Written once at the start of every .blog file.
+const char BinaryLogMagic[8] = {'B', 'L', 'O', 'G', '0', '0', '1', '\n'};
+
+struct BinaryRecordHeader
+{
+    std::int64_t ticks;      // nanoseconds since the system_clock epoch
+    std::uint64_t threadId;  // hash of the writing thread's std::thread::id
+    std::uint32_t length;    // message bytes that follow the header
+    std::uint8_t level;      // LogLevel
+    std::uint8_t reserved[3];
+};
+
+static_assert(sizeof(BinaryRecordHeader) == 24, "BinaryRecordHeader must stay 24 bytes");
+
+#endif
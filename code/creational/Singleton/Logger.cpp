@@ -4,96 +4,1725 @@
 #include <string>
 #include <chrono>
 #include <iomanip>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <condition_variable>
+#include <ctime>
+#include <cctype>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <charconv>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <deque>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "LogFormat.hpp"
+#include "LogCompression.hpp"
+#include "SingletonHolder.hpp"
+
+// Lowest level that is compiled in: 0 = Info, 1 = Warning, 2 = Error, 3 = none.
+// Build with -DLOGGER_MIN_LEVEL=1 to strip every LOG_INFO call from the binary.
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL 0
+#endif
+
+// How records are written to disk.
+enum class LogFormat : unsigned char
+{
+    Text,  // Application.log, "[YYYY-MM-DD HH:MM:SS] [Level] message" lines
+    Binary // Application.blog, fixed headers + raw messages; see LogDecoder.cpp
+};
+
+// What a producer does when the asynchronous queue is full.
+enum class OverflowPolicy : unsigned char
+{
+    Block,      // wait until the writer thread frees a slot
+    DropNewest, // discard the record being logged
+    DropOldest  // discard the oldest queued record to make room
+};
+
+// Fraction of a second appended to each timestamp.
+enum class TimestampPrecision : unsigned char
+{
+    Seconds,      // [2025-03-14 10:00:00]
+    Milliseconds, // [2025-03-14 10:00:00.123]
+    Microseconds  // [2025-03-14 10:00:00.123456]
+};
+
+// When the active log file is rotated and how many old segments are kept.
+// A zero limit is disabled.
+struct RotationPolicy
+{
+    std::uintmax_t maxBytes = 0;               // rotate once the file reaches this size
+    std::chrono::seconds interval{0};          // rotate on wall-clock boundaries (e.g. hourly)
+    std::size_t keepCount = 0;                 // rotated segments to keep
+    std::uintmax_t keepBytes = 0;              // total bytes of rotated segments to keep
+    bool compress = true;                      // compress rotated segments to .lz
+};
+
+// Where formatted records end up.
+enum class LogSink : unsigned char
+{
+    Stream, // std::ofstream, with rotation
+    Mapped  // memory-mapped append segments, see MappedLogSink
+};
+
+// One log entry. The timestamp is taken by the caller so that the
+// writer thread does not skew it when it formats the record later.
+struct LogRecord
+{
+    std::chrono::system_clock::time_point time;
+    LogLevel level;
+    std::string message;
+    std::uint64_t threadId;
+};
+
+// Bounded lock-free ring buffer (Vyukov's sequence-per-slot queue).
+// Many threads push and the writer thread pops; DropOldest producers
+// pop as well, which the per-slot sequence numbers also handle.
+class LogRingBuffer
+{
+private:
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> enqueuePos;
+    alignas(64) std::atomic<std::size_t> dequeuePos;
+
+public:
+    explicit LogRingBuffer(std::size_t capacity);
+
+    bool TryPush(LogRecord &record);
+    bool TryPop(LogRecord &record);
+};
+
+LogRingBuffer::LogRingBuffer(std::size_t capacity) : enqueuePos(0), dequeuePos(0)
+{
+    std::size_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool LogRingBuffer::TryPush(LogRecord &record)
+{
+    std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &slot = slots[pos & mask];
+        std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.record = std::move(record);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // full
+        }
+        else
+        {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool LogRingBuffer::TryPop(LogRecord &record)
+{
+    std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &slot = slots[pos & mask];
+        std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+        if (diff == 0)
+        {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                record = std::move(slot.record);
+                slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // empty
+        }
+        else
+        {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Appends one argument of a format-style log call.
+template <typename T>
+void AppendArgument(std::string &out, const T &value)
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        out += value ? "true" : "false";
+    }
+    else if constexpr (std::is_same_v<T, char>)
+    {
+        out += value;
+    }
+    else if constexpr (std::is_arithmetic_v<T>)
+    {
+        char buffer[64];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+    else if constexpr (std::is_convertible_v<const T &, std::string_view>)
+    {
+        out += std::string_view(value);
+    }
+    else
+    {
+        std::ostringstream stream;
+        stream << value;
+        out += stream.str();
+    }
+}
+
+// Copies `format` up to the next "{}" placeholder; "{{" and "}}" are literal braces.
+// Returns the rest of the format after the placeholder, or an empty view if none is left.
+inline std::string_view AppendUntilPlaceholder(std::string &out, std::string_view format, bool &found)
+{
+    found = false;
+    std::size_t i = 0;
+    while (i < format.size())
+    {
+        char c = format[i];
+        if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c)
+        {
+            out += c;
+            i += 2;
+        }
+        else if (c == '{' && i + 1 < format.size() && format[i + 1] == '}')
+        {
+            found = true;
+            return format.substr(i + 2);
+        }
+        else
+        {
+            out += c;
+            i++;
+        }
+    }
+    return std::string_view();
+}
+
+// "{}"-style formatting: FormatMessage(out, "took {} ms", 12) -> "took 12 ms".
+// Surplus arguments are dropped, surplus placeholders are left out.
+inline void FormatMessage(std::string &out, std::string_view format)
+{
+    bool found;
+    while (!format.empty())
+    {
+        format = AppendUntilPlaceholder(out, format, found);
+    }
+}
+
+template <typename First, typename... Rest>
+void FormatMessage(std::string &out, std::string_view format, const First &first, const Rest &...rest)
+{
+    bool found;
+    format = AppendUntilPlaceholder(out, format, found);
+    if (found)
+    {
+        AppendArgument(out, first);
+        FormatMessage(out, format, rest...);
+    }
+}
+
+// Per-thread cache of the last formatted "YYYY-MM-DD HH:MM:SS". Records in
+// the same second reuse it as is, records in the same minute only rewrite the
+// two seconds digits, and only a new minute pays for localtime_r + strftime.
+class TimestampCache
+{
+private:
+    std::time_t cachedSecond = 0;
+    std::time_t minuteStart = 0;
+    bool valid = false;
+    char text[20]; // "YYYY-MM-DD HH:MM:SS"
+
+public:
+    static const std::size_t Length = 19;
+
+    const char *Format(std::time_t second);
+};
+
+const char *TimestampCache::Format(std::time_t second)
+{
+    if (valid && second == cachedSecond)
+    {
+        return text;
+    }
+
+    // Time zone offsets are whole minutes, so the local minute changes
+    // exactly when the UTC minute does.
+    if (valid && second >= minuteStart && second < minuteStart + 60)
+    {
+        int seconds = static_cast<int>(second - minuteStart);
+        text[17] = static_cast<char>('0' + seconds / 10);
+        text[18] = static_cast<char>('0' + seconds % 10);
+        cachedSecond = second;
+        return text;
+    }
+
+    std::tm localTime;
+    localtime_r(&second, &localTime);
+    std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &localTime);
+    cachedSecond = second;
+    minuteStart = second - localTime.tm_sec;
+    valid = true;
+    return text;
+}
+
+// Writes `value` as exactly `digits` decimal digits, zero padded.
+static void AppendDigits(std::string &out, long value, int digits)
+{
+    char buffer[8];
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        buffer[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    out.append(buffer, static_cast<std::size_t>(digits));
+}
+
+// Per-thread block of formatted records waiting to be written in one go.
+// The mutex is only contended when Logger::flush() runs on another thread.
+struct StagingBuffer
+{
+    std::mutex mutex;
+    std::string data;
+    std::chrono::steady_clock::time_point firstWrite;
+};
+
+// Background worker for rotated segments: compresses them and applies the
+// retention limits, so the thread that rotated the file never waits on it.
+class LogArchiver
+{
+private:
+    RotationPolicy policy;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::filesystem::path> pending;
+    bool stopping;
+    std::thread worker;
+
+    void Run();
+    static void Compress(const std::filesystem::path &segment);
+    void EnforceRetention(const std::filesystem::path &logPath, const RotationPolicy &limits);
+
+public:
+    explicit LogArchiver(const RotationPolicy &policy);
+    ~LogArchiver(); // finishes every submitted segment before returning
+
+    void Configure(const RotationPolicy &policy);
+    void Submit(const std::filesystem::path &segment);
+
+    // Rotated segments of `logPath` are named "<logPath>.<YYYYMMDD-HHMMSS>-<NNN>[.lz]".
+    static bool IsSegmentOf(const std::filesystem::path &logPath, const std::filesystem::path &candidate);
+};
+
+LogArchiver::LogArchiver(const RotationPolicy &policy) : policy(policy), stopping(false)
+{
+    worker = std::thread(&LogArchiver::Run, this);
+}
+
+LogArchiver::~LogArchiver()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    worker.join();
+}
+
+void LogArchiver::Configure(const RotationPolicy &newPolicy)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    policy = newPolicy;
+}
+
+void LogArchiver::Submit(const std::filesystem::path &segment)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(segment);
+    }
+    ready.notify_one();
+}
+
+void LogArchiver::Run()
+{
+    for (;;)
+    {
+        std::filesystem::path segment;
+        RotationPolicy limits;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]()
+                       { return stopping || !pending.empty(); });
+            if (pending.empty())
+            {
+                return; // stopping and nothing left
+            }
+            segment = pending.front();
+            pending.pop_front();
+            limits = policy;
+        }
+
+        try
+        {
+            if (limits.compress)
+            {
+                Compress(segment);
+            }
+            std::string name = segment.filename().string();
+            std::filesystem::path logPath = segment.parent_path() / name.substr(0, name.rfind('.'));
+            EnforceRetention(logPath, limits);
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Log archiver: " << ex.what() << std::endl;
+        }
+    }
+}
+
+// Writes "<segment>.lz" through a temporary file and a rename, then removes the original.
+void LogArchiver::Compress(const std::filesystem::path &segment)
+{
+    std::filesystem::path target = segment;
+    target += ".lz";
+    std::filesystem::path temporary = target;
+    temporary += ".tmp";
+
+    {
+        std::ifstream in(segment, std::ios::binary);
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!in.is_open() || !out.is_open())
+        {
+            throw std::runtime_error("Cannot compress " + segment.string());
+        }
+        CompressStream(in, out);
+        out.flush();
+        if (!out)
+        {
+            out.close();
+            std::filesystem::remove(temporary);
+            throw std::runtime_error("Failed to write " + temporary.string());
+        }
+    }
+    std::filesystem::rename(temporary, target);
+    std::filesystem::remove(segment);
+}
+
+bool LogArchiver::IsSegmentOf(const std::filesystem::path &logPath, const std::filesystem::path &candidate)
+{
+    std::string prefix = logPath.filename().string() + ".";
+    std::string name = candidate.filename().string();
+    return name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+           std::isdigit(static_cast<unsigned char>(name[prefix.size()])) &&
+           name.compare(name.size() - 4, 4, ".tmp") != 0;
+}
+
+// Deletes the oldest rotated segments until both retention limits hold.
+void LogArchiver::EnforceRetention(const std::filesystem::path &logPath, const RotationPolicy &limits)
+{
+    if (limits.keepCount == 0 && limits.keepBytes == 0)
+    {
+        return;
+    }
+
+    std::filesystem::path directory = logPath.has_parent_path() ? logPath.parent_path() : ".";
+    std::deque<std::filesystem::path> queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued = pending;
+    }
+
+    std::vector<std::pair<std::filesystem::path, std::uintmax_t>> segments;
+    std::uintmax_t totalBytes = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    {
+        // Segments still waiting for compression are not counted yet.
+        bool isQueued = std::any_of(queued.begin(), queued.end(), [&entry](const std::filesystem::path &segment)
+                                    { return std::filesystem::equivalent(segment, entry.path()); });
+        if (entry.is_regular_file() && IsSegmentOf(logPath, entry.path()) && !isQueued)
+        {
+            segments.emplace_back(entry.path(), entry.file_size());
+            totalBytes += entry.file_size();
+        }
+    }
+    // Names are "<log>.<UTC stamp>-<sequence within that second>", so they
+    // sort from oldest to newest (see Logger::Rotate).
+    std::sort(segments.begin(), segments.end());
+
+    std::size_t count = segments.size();
+    for (const auto &segment : segments)
+    {
+        bool tooMany = limits.keepCount != 0 && count > limits.keepCount;
+        bool tooBig = limits.keepBytes != 0 && totalBytes > limits.keepBytes;
+        if (!tooMany && !tooBig)
+        {
+            break;
+        }
+        std::filesystem::remove(segment.first);
+        count--;
+        totalBytes -= segment.second;
+    }
+}
+
+// Append-only sink that writes into a memory-mapped region of the log file.
+// Writers reserve space with one fetch_add on the current segment and memcpy
+// into the mapping; the kernel writes the pages back. The writer whose record
+// crosses the end of a segment rolls it: the file is extended and the next
+// segment is mapped starting exactly where the last record ended, so the file
+// has no gaps. Until the sink is closed the file is pre-allocated, so readers
+// see zero bytes after the last record.
+class MappedLogSink
+{
+private:
+    struct Segment
+    {
+        std::uint64_t start;   // file offset of data[0]
+        std::size_t capacity;  // bytes available at data
+        char *mapping;         // page-aligned mapping that contains data
+        std::size_t mappingLength;
+        char *data;
+        std::atomic<std::size_t> reserved{0};
+        std::atomic<std::size_t> committed{0};
+        std::size_t sealedAt = static_cast<std::size_t>(-1); // bytes used when rolled
+        std::atomic<unsigned> failedRolls{0};                 // rolls that could not map the next segment
+    };
+
+    int fd;
+    std::size_t segmentBytes;
+    std::chrono::milliseconds syncInterval;
+    std::atomic<Segment *> current;
+    std::atomic<unsigned> appending; // Append calls that may still hold an old segment pointer
+    std::mutex rollMutex;
+    std::vector<std::unique_ptr<Segment>> segments; // guarded by rollMutex
+    std::uint64_t fileSize;                         // guarded by rollMutex
+    bool rollFailing = false;                       // guarded by rollMutex; reported once
+    std::atomic<std::int64_t> lastSync;
+
+    Segment *MapSegment(std::uint64_t start, std::size_t capacity);
+    bool Roll(Segment *full, std::size_t used, std::size_t needed);
+    void MaybeSync(Segment *segment);
+
+public:
+    MappedLogSink(const std::filesystem::path &path, std::size_t segmentBytes,
+                  std::chrono::milliseconds syncInterval);
+    ~MappedLogSink(); // trims the file to the last record
+
+    MappedLogSink(const MappedLogSink &) = delete;
+    MappedLogSink &operator=(const MappedLogSink &) = delete;
+
+    void Append(const char *data, std::size_t size);
+    void Sync(); // msync(MS_SYNC) everything written so far
+};
+
+MappedLogSink::MappedLogSink(const std::filesystem::path &path, std::size_t segmentBytes,
+                             std::chrono::milliseconds syncInterval)
+    : segmentBytes(segmentBytes), syncInterval(syncInterval), current(nullptr), appending(0), lastSync(0)
+{
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open log file");
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Failed to open log file");
+    }
+    fileSize = static_cast<std::uint64_t>(info.st_size);
+
+    std::lock_guard<std::mutex> lock(rollMutex);
+    current.store(MapSegment(fileSize, segmentBytes), std::memory_order_release);
+}
+
+MappedLogSink::~MappedLogSink()
+{
+    Segment *last = current.load(std::memory_order_acquire);
+    std::uint64_t end = last->start + last->committed.load(std::memory_order_acquire);
+    for (auto &segment : segments)
+    {
+        if (segment->mapping)
+        {
+            ::msync(segment->mapping, segment->mappingLength, MS_SYNC);
+            ::munmap(segment->mapping, segment->mappingLength);
+        }
+    }
+    if (::ftruncate(fd, static_cast<off_t>(end)) != 0)
+    {
+        std::cerr << "Failed to trim mapped log file" << std::endl;
+    }
+    ::close(fd);
+}
+
+// Maps [start, start + capacity) of the file; called with rollMutex held.
+MappedLogSink::Segment *MappedLogSink::MapSegment(std::uint64_t start, std::size_t capacity)
+{
+    if (start + capacity > fileSize)
+    {
+        if (::ftruncate(fd, static_cast<off_t>(start + capacity)) != 0)
+        {
+            throw std::runtime_error("Failed to extend mapped log file");
+        }
+        fileSize = start + capacity;
+    }
+
+    // mmap offsets must be page aligned; the data pointer starts inside the first page.
+    std::uint64_t pageSize = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    std::uint64_t mapOffset = start - start % pageSize;
+    std::size_t delta = static_cast<std::size_t>(start - mapOffset);
+
+    auto segment = std::make_unique<Segment>();
+    segment->start = start;
+    segment->capacity = capacity;
+    segment->mappingLength = delta + capacity;
+    void *mapping = ::mmap(nullptr, segment->mappingLength, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           fd, static_cast<off_t>(mapOffset));
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map log segment");
+    }
+    segment->mapping = static_cast<char *>(mapping);
+    segment->data = segment->mapping + delta;
+
+    segments.push_back(std::move(segment));
+    return segments.back().get();
+}
+
+// False if the next segment could not be mapped (e.g. the disk is full).
+bool MappedLogSink::Roll(Segment *full, std::size_t used, std::size_t needed)
+{
+    std::lock_guard<std::mutex> lock(rollMutex);
+    Segment *next;
+    try
+    {
+        next = MapSegment(full->start + used, std::max(segmentBytes, needed));
+    }
+    catch (const std::exception &error)
+    {
+        // Hand the overshot space back, so the next record retries the roll,
+        // and release the writers waiting for this one; their records and
+        // this one are dropped. Reported once until a roll succeeds.
+        full->reserved.store(used, std::memory_order_seq_cst);
+        full->failedRolls.fetch_add(1, std::memory_order_release);
+        if (!rollFailing)
+        {
+            std::cerr << error.what() << "; dropping log records" << std::endl;
+            rollFailing = true;
+        }
+        return false;
+    }
+    if (rollFailing)
+    {
+        std::cerr << "Mapped log recovered" << std::endl;
+        rollFailing = false;
+    }
+    full->sealedAt = used;
+    current.store(next, std::memory_order_seq_cst);
+
+    // Unmap retired segments whose writers have all finished their memcpy.
+    for (auto &segment : segments)
+    {
+        if (segment.get() != next && segment->mapping &&
+            segment->committed.load(std::memory_order_acquire) == segment->sealedAt)
+        {
+            ::munmap(segment->mapping, segment->mappingLength);
+            segment->mapping = nullptr;
+        }
+    }
+
+    // Free unmapped segments once no other Append is running: any later one
+    // loads `next`, so nothing can still reach them. Otherwise a later roll
+    // (or the destructor) frees them.
+    if (appending.load(std::memory_order_seq_cst) == 1)
+    {
+        segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                      [](const std::unique_ptr<Segment> &segment) { return !segment->mapping; }),
+                       segments.end());
+    }
+    return true;
+}
+
+// Asks the kernel to start write-back at most once per syncInterval. Runs
+// before the writer commits, so the segment cannot be unmapped underneath.
+void MappedLogSink::MaybeSync(Segment *segment)
+{
+    if (syncInterval.count() <= 0)
+    {
+        return;
+    }
+    std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    std::int64_t last = lastSync.load(std::memory_order_relaxed);
+    if (now - last >= syncInterval.count() &&
+        lastSync.compare_exchange_strong(last, now, std::memory_order_relaxed))
+    {
+        ::msync(segment->mapping, segment->mappingLength, MS_ASYNC);
+    }
+}
+
+void MappedLogSink::Append(const char *data, std::size_t size)
+{
+    struct AppendScope
+    {
+        std::atomic<unsigned> &appending;
+        explicit AppendScope(std::atomic<unsigned> &appending) : appending(appending)
+        {
+            appending.fetch_add(1, std::memory_order_seq_cst);
+        }
+        ~AppendScope() { appending.fetch_sub(1, std::memory_order_release); }
+    } scope(appending);
+
+    for (;;)
+    {
+        Segment *segment = current.load(std::memory_order_seq_cst);
+        unsigned failedRolls = segment->failedRolls.load(std::memory_order_acquire);
+        std::size_t offset = segment->reserved.fetch_add(size, std::memory_order_acq_rel);
+        if (offset + size <= segment->capacity)
+        {
+            std::memcpy(segment->data + offset, data, size);
+            MaybeSync(segment);
+            segment->committed.fetch_add(size, std::memory_order_release);
+            return;
+        }
+        if (offset <= segment->capacity)
+        {
+            // First record that does not fit: this writer rolls the segment.
+            if (!Roll(segment, offset, size))
+            {
+                return;
+            }
+        }
+        else
+        {
+            while (current.load(std::memory_order_acquire) == segment)
+            {
+                if (segment->failedRolls.load(std::memory_order_acquire) != failedRolls)
+                {
+                    return; // the roll this writer waited for failed
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+void MappedLogSink::Sync()
+{
+    std::lock_guard<std::mutex> lock(rollMutex);
+    for (auto &segment : segments)
+    {
+        if (segment->mapping)
+        {
+            ::msync(segment->mapping, segment->mappingLength, MS_SYNC);
+        }
+    }
+}
+
 class Logger
 {
 private:
     Logger();
     ~Logger();
 
-    static Logger *Logger_instance;
-
-    static void Cleanup(); // Function to clean up the singleton instance.
+    friend class SingletonHolder<Logger>; // Creates and destroys the single instance.
     std::ofstream logFile;
     static std::mutex logMutex; // For thread safety
+
+    // Asynchronous mode state
+    std::unique_ptr<LogRingBuffer> queue;
+    OverflowPolicy overflowPolicy;
+    std::atomic<bool> asyncEnabled;
+    std::atomic<unsigned> asyncProducers; // WriteLog calls between the asyncEnabled check and the push
+    std::atomic<bool> stopWriter;
+    std::atomic<bool> writerSleeping;
+    std::atomic<std::size_t> droppedCount;
+    std::thread writerThread;
+    std::mutex asyncControlMutex; // serializes EnableAsync and StopAsync
+    std::mutex wakeMutex;
+    std::condition_variable wakeWriter;
+
+    static const std::size_t WriterBatchSize = 256;
+
+    // Staged mode state. The registry is static so a thread that exits after
+    // the Logger is destroyed can still unregister its buffer safely;
+    // stagingOwner is the live Logger, or null once it is being destroyed.
+    std::atomic<bool> stagingEnabled;
+    std::atomic<std::size_t> stagingFlushBytes;                       // read by every Stage call
+    std::atomic<std::chrono::milliseconds::rep> stagingFlushInterval; // milliseconds
+    static std::mutex stagingMutex;
+    static std::vector<StagingBuffer *> stagingBuffers;
+    static Logger *stagingOwner;
+
+    // Flushes buffers of threads that went quiet once flushInterval passed.
+    std::thread stagingFlusher;
+    std::mutex stagingFlusherMutex; // guards stopStagingFlusher
+    std::condition_variable stagingFlusherWake;
+    bool stopStagingFlusher;
+
+    struct StagingHandle
+    {
+        StagingBuffer *buffer;
+        StagingHandle();
+        ~StagingHandle();
+    };
+
+    void Enqueue(LogRecord &record);
+    void WriterLoop();
+    bool DrainBatch(std::string &buffer);
+    void StopAsync();
+    std::atomic<TimestampPrecision> timestampPrecision;
+
+    std::atomic<LogFormat> logFormat;
+    std::atomic<LogLevel> minLevel;
+
+    // Rotation state, guarded by logMutex.
+    std::filesystem::path logPath;
+    RotationPolicy rotation;
+    std::uintmax_t fileBytes;
+    std::chrono::system_clock::time_point nextRotation;
+    std::string rotationStamp;  // UTC second of the last rotated segment's name
+    unsigned rotationSequence;  // segments named within rotationStamp so far
+    bool rotationFailing; // the last rename failed and was reported
+    std::unique_ptr<LogArchiver> archiver;
+
+    // Mapped sink; writers use it without taking logMutex.
+    std::unique_ptr<MappedLogSink> mappedSinkOwner;
+    std::atomic<MappedLogSink *> mappedSink;
+    std::size_t mappedSegmentBytes;
+    std::chrono::milliseconds mappedSyncInterval;
+
+    void OpenLogFile();
+    void OpenMappedSink();
+    void CloseMappedSink();
+    void WriteLocked(const char *data, std::size_t size);
+    void Rotate();
+
+    void FormatRecord(std::string &out, const LogRecord &record);
+    static void EncodeRecord(std::string &out, const LogRecord &record);
+    void AppendRecord(std::string &out, const LogRecord &record);
+    void Stage(const LogRecord &record);
+    void FlushStagingBuffer(StagingBuffer &staging);
+    void StagingFlusherLoop();
+    void StopStagingFlusher();
+    void WriteBlock(const std::string &block);
+
 public:
     static Logger &Get_instance();
 
     Logger(const Logger &) = delete;
     Logger &operator=(const Logger &) = delete;
 
+    // Switch to asynchronous logging: callers only push into a bounded queue
+    // and a dedicated writer thread drains it in batches to the log file.
+    void EnableAsync(std::size_t capacity = 8192, OverflowPolicy policy = OverflowPolicy::Block);
+
+    // Back to synchronous logging. Every record queued, or being queued by a
+    // thread that already saw async mode, is written first.
+    void DisableAsync();
+
+    // Switch to staged logging: each thread formats into its own buffer and
+    // hands whole blocks to the file once `flushBytes` or `flushInterval` is
+    // reached. Lines from different threads are ordered per block, not globally.
+    void EnableStaging(std::size_t flushBytes = 64 * 1024,
+                       std::chrono::milliseconds flushInterval = std::chrono::milliseconds(200));
+
+    // Add milli- or microseconds to the timestamp of every record.
+    void SetTimestampPrecision(TimestampPrecision precision);
+
+    // Switch between Application.log (text) and Application.blog (binary).
+    // Call it before other threads start logging; records staged so far are
+    // flushed to the current file first.
+    void SetFormat(LogFormat format);
+
+    // Rotate the log file by size and/or wall-clock interval. Rotated segments
+    // are renamed atomically and compressed and pruned on a background thread.
+    void SetRotation(const RotationPolicy &policy);
+
+    // Choose the stream sink or the memory-mapped sink. The mapped sink grows
+    // the file `segmentBytes` at a time, starts kernel write-back every
+    // `syncInterval` and does not rotate. Call it while no other thread logs.
+    void SetSink(LogSink sink, std::size_t segmentBytes = 64 * 1024 * 1024,
+                 std::chrono::milliseconds syncInterval = std::chrono::milliseconds(1000));
+
+    // Write out every thread's staged records and flush the file stream.
+    void flush();
+
+    // Runtime threshold on top of LOGGER_MIN_LEVEL; records below it are skipped.
+    void SetLevel(LogLevel level);
+    bool IsEnabled(LogLevel level) const;
+
     void logInfo(const std::string &message);
     void logWarning(const std::string &message);
     void logError(const std::string &message);
 
-    void WriteLog(const std::string &level, const std::string &message);
+    // Format-style logging: the message is only built once both the compile-time
+    // and the runtime level checks pass, e.g. Log<LogLevel::Info>("got {} rows", n).
+    template <LogLevel Level, typename... Args>
+    void Log(std::string_view format, const Args &...args);
+
+    void WriteLog(LogLevel level, std::string message);
 };
-Logger *Logger::Logger_instance = nullptr;
+
+template <LogLevel Level, typename... Args>
+void Logger::Log(std::string_view format, const Args &...args)
+{
+    if constexpr (static_cast<int>(Level) >= LOGGER_MIN_LEVEL)
+    {
+        if (!IsEnabled(Level))
+        {
+            return;
+        }
+        std::string message;
+        FormatMessage(message, format, args...);
+        WriteLog(Level, std::move(message));
+    }
+}
+
+// Below LOGGER_MIN_LEVEL these expand to nothing, so not even the arguments are evaluated.
+#if LOGGER_MIN_LEVEL <= 0
+#define LOG_INFO(...) Logger::Get_instance().Log<LogLevel::Info>(__VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LOGGER_MIN_LEVEL <= 1
+#define LOG_WARNING(...) Logger::Get_instance().Log<LogLevel::Warning>(__VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+#if LOGGER_MIN_LEVEL <= 2
+#define LOG_ERROR(...) Logger::Get_instance().Log<LogLevel::Error>(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
 // Initialize the static mutex
 std::mutex Logger::logMutex;
+std::mutex Logger::stagingMutex;
+std::vector<StagingBuffer *> Logger::stagingBuffers;
+Logger *Logger::stagingOwner = nullptr;
+
+static std::uint64_t CurrentThreadId()
+{
+    static thread_local std::uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return id;
+}
+
 Logger::Logger()
+    : overflowPolicy(OverflowPolicy::Block), asyncEnabled(false), asyncProducers(0), stopWriter(false),
+      writerSleeping(false), droppedCount(0), stagingEnabled(false),
+      stagingFlushBytes(64 * 1024), stagingFlushInterval(200), stopStagingFlusher(false),
+      timestampPrecision(TimestampPrecision::Seconds), logFormat(LogFormat::Text),
+      minLevel(LogLevel::Info), logPath("Application.log"), fileBytes(0), rotationSequence(0),
+      rotationFailing(false),
+      mappedSink(nullptr), mappedSegmentBytes(0), mappedSyncInterval(0)
+{
+    OpenLogFile();
+
+    std::lock_guard<std::mutex> lock(stagingMutex);
+    stagingOwner = this;
+}
+Logger::~Logger()
+{
+    StopStagingFlusher();
+    {
+        // Flush staged records and retire the instance under the registry
+        // lock, so exiting threads either flush themselves first or find nothing.
+        std::lock_guard<std::mutex> lock(stagingMutex);
+        for (StagingBuffer *staging : stagingBuffers)
+        {
+            FlushStagingBuffer(*staging);
+        }
+        stagingOwner = nullptr;
+    }
+    StopAsync(); // Drain everything still queued before the file is closed.
+    CloseMappedSink();
+    if (logFile.is_open())
+    {
+        logFile.close();
+    }
+    archiver.reset(); // Wait for pending segments to be compressed.
+}
+
+// Opens logPath for appending; called with logMutex held (or from the constructor).
+void Logger::OpenLogFile()
 {
-    logFile.open("Application.log", std::ios::app);
+    if (logFormat.load(std::memory_order_relaxed) == LogFormat::Binary)
+    {
+        logFile.open(logPath, std::ios::app | std::ios::binary);
+        if (logFile.is_open() && logFile.tellp() == 0)
+        {
+            logFile.write(BinaryLogMagic, sizeof(BinaryLogMagic));
+        }
+    }
+    else
+    {
+        logFile.open(logPath, std::ios::app);
+    }
     if (!logFile.is_open())
     {
         throw std::runtime_error("Failed to open log file");
     }
+    fileBytes = static_cast<std::uintmax_t>(logFile.tellp());
+
+    // Interval rotation happens on epoch-aligned boundaries, e.g. on the hour.
+    if (rotation.interval.count() > 0)
+    {
+        auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+        auto elapsed = now.time_since_epoch() % rotation.interval;
+        nextRotation = now - elapsed + rotation.interval;
+    }
 }
-Logger::~Logger()
+
+// Every write to the file goes through here, with logMutex held.
+void Logger::WriteLocked(const char *data, std::size_t size)
 {
-    if (logFile.is_open())
+    logFile.write(data, static_cast<std::streamsize>(size));
+    logFile.flush();
+    fileBytes += size;
+
+    bool sizeDue = rotation.maxBytes != 0 && fileBytes >= rotation.maxBytes;
+    bool timeDue = rotation.interval.count() > 0 && std::chrono::system_clock::now() >= nextRotation;
+    if (sizeDue || timeDue)
     {
-        logFile.close();
+        Rotate();
+    }
+}
+
+void Logger::Rotate()
+{
+    logFile.close();
+
+    // UTC, so that names keep sorting in creation order when local time
+    // repeats an hour (DST fall-back).
+    auto time_t_now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm utcTime;
+    gmtime_r(&time_t_now, &utcTime);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%SZ", &utcTime);
+    if (rotationStamp != stamp)
+    {
+        rotationStamp = stamp;
+        rotationSequence = 0;
+    }
+
+    // A new name every time, even for several rotations within one second;
+    // the sequence restarts each second and never wraps within one.
+    std::filesystem::path segment;
+    std::error_code error;
+    do
+    {
+        char suffix[48];
+        std::snprintf(suffix, sizeof(suffix), ".%s-%06u", stamp, rotationSequence++);
+        segment = logPath;
+        segment += suffix;
+    } while (std::filesystem::exists(segment, error) ||
+             std::filesystem::exists(std::filesystem::path(segment) += ".lz", error));
+
+    std::filesystem::rename(logPath, segment, error);
+    OpenLogFile(); // also moves nextRotation to the next interval
+    if (error)
+    {
+        // Back off: the file is still over maxBytes, so without this every
+        // write would try (and fail) to rotate again. Retry after another
+        // maxBytes or at the next interval, and report the error once.
+        fileBytes = 0;
+        if (!rotationFailing)
+        {
+            std::cerr << "Log rotation failed: " << error.message() << std::endl;
+            rotationFailing = true;
+        }
+        return;
+    }
+    if (rotationFailing)
+    {
+        std::cerr << "Log rotation recovered" << std::endl;
+        rotationFailing = false;
+    }
+    if (archiver)
+    {
+        archiver->Submit(segment);
     }
 }
 
+// Hands logPath from the stream to a mapped sink; called with logMutex held.
+void Logger::OpenMappedSink()
+{
+    logFile.close(); // flushes the binary magic if it was just written
+    mappedSinkOwner = std::make_unique<MappedLogSink>(logPath, mappedSegmentBytes, mappedSyncInterval);
+    mappedSink.store(mappedSinkOwner.get(), std::memory_order_release);
+}
+
+void Logger::CloseMappedSink()
+{
+    mappedSink.store(nullptr, std::memory_order_release);
+    mappedSinkOwner.reset();
+}
+
+void Logger::SetSink(LogSink sink, std::size_t segmentBytes, std::chrono::milliseconds syncInterval)
+{
+    flush();
+    std::lock_guard<std::mutex> lock(logMutex);
+    mappedSegmentBytes = segmentBytes;
+    mappedSyncInterval = syncInterval;
+    CloseMappedSink();
+    if (sink == LogSink::Mapped)
+    {
+        OpenMappedSink();
+    }
+    else if (!logFile.is_open())
+    {
+        OpenLogFile();
+    }
+}
+
+void Logger::SetRotation(const RotationPolicy &policy)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    rotation = policy;
+    if (archiver)
+    {
+        archiver->Configure(policy);
+    }
+    else
+    {
+        archiver = std::make_unique<LogArchiver>(policy);
+    }
+    if (rotation.interval.count() > 0)
+    {
+        auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+        nextRotation = now - now.time_since_epoch() % rotation.interval + rotation.interval;
+    }
+}
+
+// Race-free lazy creation; the instance is destroyed at exit by SingletonRegistry.
 Logger &Logger::Get_instance()
 {
-    if (!Logger_instance)
+    return SingletonHolder<Logger>::Instance();
+}
+
+void Logger::EnableAsync(std::size_t capacity, OverflowPolicy policy)
+{
+    std::lock_guard<std::mutex> lock(asyncControlMutex);
+    if (asyncEnabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    queue = std::make_unique<LogRingBuffer>(capacity);
+    overflowPolicy = policy;
+    stopWriter.store(false, std::memory_order_relaxed);
+    writerThread = std::thread(&Logger::WriterLoop, this);
+    asyncEnabled.store(true, std::memory_order_release);
+}
+
+void Logger::EnableStaging(std::size_t flushBytes, std::chrono::milliseconds flushInterval)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    {
+        std::lock_guard<std::mutex> flusherLock(stagingFlusherMutex);
+        stagingFlushBytes.store(flushBytes, std::memory_order_relaxed);
+        stagingFlushInterval.store(flushInterval.count(), std::memory_order_relaxed);
+        if (!stagingFlusher.joinable())
+        {
+            stopStagingFlusher = false;
+            stagingFlusher = std::thread(&Logger::StagingFlusherLoop, this);
+        }
+    }
+    stagingFlusherWake.notify_one(); // pick up the new interval
+    stagingEnabled.store(true, std::memory_order_release);
+}
+
+// Stage only checks the time threshold when its own thread logs again; this
+// sweep writes out buffers whose oldest record has waited flushInterval, so
+// a thread that logs once and goes idle is not held back until it exits.
+void Logger::StagingFlusherLoop()
+{
+    std::unique_lock<std::mutex> lock(stagingFlusherMutex);
+    while (!stopStagingFlusher)
+    {
+        std::chrono::milliseconds interval(stagingFlushInterval.load(std::memory_order_relaxed));
+        stagingFlusherWake.wait_for(lock, std::max(interval / 2, std::chrono::milliseconds(1)));
+        if (stopStagingFlusher)
+        {
+            break;
+        }
+        interval = std::chrono::milliseconds(stagingFlushInterval.load(std::memory_order_relaxed));
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> registryLock(stagingMutex);
+            auto now = std::chrono::steady_clock::now();
+            for (StagingBuffer *staging : stagingBuffers)
+            {
+                bool due;
+                {
+                    std::lock_guard<std::mutex> stagingLock(staging->mutex);
+                    due = !staging->data.empty() && now - staging->firstWrite >= interval;
+                }
+                if (due)
+                {
+                    FlushStagingBuffer(*staging);
+                }
+            }
+        }
+        lock.lock();
+    }
+}
+
+void Logger::StopStagingFlusher()
+{
+    {
+        std::lock_guard<std::mutex> lock(stagingFlusherMutex);
+        stopStagingFlusher = true;
+    }
+    stagingFlusherWake.notify_one();
+    if (stagingFlusher.joinable())
+    {
+        stagingFlusher.join();
+    }
+}
+
+Logger::StagingHandle::StagingHandle() : buffer(new StagingBuffer())
+{
+    std::lock_guard<std::mutex> lock(stagingMutex);
+    stagingBuffers.push_back(buffer);
+}
+
+Logger::StagingHandle::~StagingHandle()
+{
+    // Runs at thread exit: hand over whatever this thread still has staged.
+    std::lock_guard<std::mutex> lock(stagingMutex);
+    stagingBuffers.erase(std::remove(stagingBuffers.begin(), stagingBuffers.end(), buffer),
+                         stagingBuffers.end());
+    if (stagingOwner)
+    {
+        stagingOwner->FlushStagingBuffer(*buffer);
+    }
+    delete buffer;
+}
+
+void Logger::SetTimestampPrecision(TimestampPrecision precision)
+{
+    timestampPrecision.store(precision, std::memory_order_relaxed);
+}
+
+void Logger::SetFormat(LogFormat format)
+{
+    flush();
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (logFormat.load(std::memory_order_relaxed) == format)
+    {
+        return;
+    }
+
+    bool mapped = mappedSink.load(std::memory_order_relaxed) != nullptr;
+    CloseMappedSink();
+    logFile.close();
+    logFormat.store(format, std::memory_order_release);
+    logPath = format == LogFormat::Binary ? "Application.blog" : "Application.log";
+    OpenLogFile();
+    if (mapped)
+    {
+        OpenMappedSink();
+    }
+}
+
+// Binary records skip all formatting: a fixed header and a memcpy of the message.
+void Logger::EncodeRecord(std::string &out, const LogRecord &record)
+{
+    BinaryRecordHeader header{};
+    header.ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(record.time.time_since_epoch()).count();
+    header.threadId = record.threadId;
+    header.length = static_cast<std::uint32_t>(record.message.size());
+    header.level = static_cast<std::uint8_t>(record.level);
+
+    std::size_t offset = out.size();
+    out.resize(offset + sizeof(header) + record.message.size());
+    std::memcpy(&out[offset], &header, sizeof(header));
+    std::memcpy(&out[offset + sizeof(header)], record.message.data(), record.message.size());
+}
+
+void Logger::AppendRecord(std::string &out, const LogRecord &record)
+{
+    if (logFormat.load(std::memory_order_acquire) == LogFormat::Binary)
+    {
+        EncodeRecord(out, record);
+    }
+    else
+    {
+        FormatRecord(out, record);
+    }
+}
+
+void Logger::FormatRecord(std::string &out, const LogRecord &record)
+{
+    // Thread-local, so staged records can be formatted concurrently.
+    static thread_local TimestampCache timestampCache;
+
+    auto second = std::chrono::floor<std::chrono::seconds>(record.time);
+    auto fraction = std::chrono::duration_cast<std::chrono::microseconds>(record.time - second).count();
+
+    out += '[';
+    out.append(timestampCache.Format(std::chrono::system_clock::to_time_t(second)), TimestampCache::Length);
+    switch (timestampPrecision.load(std::memory_order_relaxed))
     {
-        Logger_instance = new Logger();
-        std::atexit(Cleanup); // Register cleanup function to delete instance at program exit.
+    case TimestampPrecision::Seconds:
+        break;
+    case TimestampPrecision::Milliseconds:
+        out += '.';
+        AppendDigits(out, static_cast<long>(fraction / 1000), 3);
+        break;
+    case TimestampPrecision::Microseconds:
+        out += '.';
+        AppendDigits(out, static_cast<long>(fraction), 6);
+        break;
     }
+    out += "] [";
+    out += LevelName(record.level);
+    out += "] ";
+    out += record.message;
+    out += '\n';
+}
+
+void Logger::SetLevel(LogLevel level)
+{
+    minLevel.store(level, std::memory_order_relaxed);
+}
 
-    return *Logger_instance;
+bool Logger::IsEnabled(LogLevel level) const
+{
+#if LOGGER_MIN_LEVEL > 0 // at 0 every level is compiled in, and the check would always pass
+    if (static_cast<int>(level) < LOGGER_MIN_LEVEL)
+    {
+        return false;
+    }
+#endif
+    return level >= minLevel.load(std::memory_order_relaxed);
 }
 
-void Logger::WriteLog(const std::string &level, const std::string &message)
+void Logger::WriteLog(LogLevel level, std::string message)
 {
+    LogRecord record{std::chrono::system_clock::now(), level, std::move(message), CurrentThreadId()};
+
+    if (asyncEnabled.load(std::memory_order_acquire))
+    {
+        // Announce the push, then check again: StopAsync clears the flag
+        // before the writer waits for announced pushes, so either this push
+        // is seen by the final drain or this thread sees async mode is off.
+        asyncProducers.fetch_add(1, std::memory_order_seq_cst);
+        if (asyncEnabled.load(std::memory_order_seq_cst))
+        {
+            Enqueue(record);
+            asyncProducers.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+        asyncProducers.fetch_sub(1, std::memory_order_release);
+    }
+
+    if (stagingEnabled.load(std::memory_order_acquire))
+    {
+        Stage(record);
+        return;
+    }
+
+    std::string line;
+    AppendRecord(line, record);
+
+    if (MappedLogSink *sink = mappedSink.load(std::memory_order_acquire))
+    {
+        sink->Append(line.data(), line.size());
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(logMutex); // Ensure thread safety
+    WriteLocked(line.data(), line.size());
+}
+
+void Logger::Stage(const LogRecord &record)
+{
+    static thread_local StagingHandle handle;
+    StagingBuffer &staging = *handle.buffer;
 
-    // Get current time
-    auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    auto localTime = std::localtime(&time_t_now);
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(staging.mutex);
+        auto now = std::chrono::steady_clock::now();
+        if (staging.data.empty())
+        {
+            staging.firstWrite = now;
+        }
+        AppendRecord(staging.data, record);
+        full = staging.data.size() >= stagingFlushBytes.load(std::memory_order_relaxed) ||
+               now - staging.firstWrite >=
+                   std::chrono::milliseconds(stagingFlushInterval.load(std::memory_order_relaxed));
+    }
 
-    // Write the log entry
-    logFile << "[" << std::put_time(localTime, "%Y-%m-%d %H:%M:%S") << "] "
-            << "[" << level << "] " << message << std::endl;
+    if (full)
+    {
+        FlushStagingBuffer(staging);
+    }
+}
+
+void Logger::FlushStagingBuffer(StagingBuffer &staging)
+{
+    std::string block;
+    {
+        std::lock_guard<std::mutex> lock(staging.mutex);
+        block.swap(staging.data);
+    }
+    if (!block.empty())
+    {
+        WriteBlock(block);
+    }
+}
+
+// One write and one flush for a whole block of formatted records.
+void Logger::WriteBlock(const std::string &block)
+{
+    if (MappedLogSink *sink = mappedSink.load(std::memory_order_acquire))
+    {
+        sink->Append(block.data(), block.size());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(logMutex);
+    WriteLocked(block.data(), block.size());
+}
+
+void Logger::flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(stagingMutex);
+        for (StagingBuffer *staging : stagingBuffers)
+        {
+            FlushStagingBuffer(*staging);
+        }
+    }
+    if (MappedLogSink *sink = mappedSink.load(std::memory_order_acquire))
+    {
+        sink->Sync();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(logMutex);
+    logFile.flush();
+}
+
+void Logger::Enqueue(LogRecord &record)
+{
+    while (!queue->TryPush(record))
+    {
+        if (overflowPolicy == OverflowPolicy::DropNewest)
+        {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (overflowPolicy == OverflowPolicy::DropOldest)
+        {
+            LogRecord oldest;
+            if (queue->TryPop(oldest))
+            {
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        // Block: give the writer a chance to catch up.
+        wakeWriter.notify_one();
+        std::this_thread::yield();
+    }
+
+    if (writerSleeping.load(std::memory_order_acquire))
+    {
+        wakeWriter.notify_one();
+    }
+}
+
+// Pops up to one batch into `buffer`. Returns false if the queue was empty.
+bool Logger::DrainBatch(std::string &buffer)
+{
+    buffer.clear();
+
+    std::size_t dropped = droppedCount.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+    {
+        LogRecord notice{std::chrono::system_clock::now(), LogLevel::Warning,
+                         std::to_string(dropped) + " log records dropped (queue full)", CurrentThreadId()};
+        AppendRecord(buffer, notice);
+    }
+
+    LogRecord record;
+    std::size_t count = 0;
+    while (count < WriterBatchSize && queue->TryPop(record))
+    {
+        AppendRecord(buffer, record);
+        count++;
+    }
+
+    if (!buffer.empty())
+    {
+        WriteBlock(buffer);
+    }
+    return count > 0;
+}
+
+void Logger::WriterLoop()
+{
+    std::string buffer;
+    while (!stopWriter.load(std::memory_order_acquire))
+    {
+        if (DrainBatch(buffer))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        writerSleeping.store(true, std::memory_order_release);
+        wakeWriter.wait_for(lock, std::chrono::milliseconds(10));
+        writerSleeping.store(false, std::memory_order_relaxed);
+    }
+
+    // Final drain so nothing queued before shutdown is lost, including pushes
+    // still in progress on threads that saw async mode before it was stopped.
+    for (;;)
+    {
+        bool pushing = asyncProducers.load(std::memory_order_seq_cst) > 0;
+        if (DrainBatch(buffer))
+        {
+            continue;
+        }
+        if (!pushing)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void Logger::DisableAsync()
+{
+    StopAsync();
+}
+
+// Not under logMutex: the writer takes it for its final drain.
+void Logger::StopAsync()
+{
+    std::lock_guard<std::mutex> lock(asyncControlMutex);
+    if (!asyncEnabled.exchange(false, std::memory_order_seq_cst))
+    {
+        return;
+    }
+    stopWriter.store(true, std::memory_order_release);
+    wakeWriter.notify_one();
+    if (writerThread.joinable())
+    {
+        writerThread.join();
+    }
 }
 
 void Logger::logInfo(const std::string &message)
 {
-    WriteLog("Info", message);
+    if (IsEnabled(LogLevel::Info))
+        WriteLog(LogLevel::Info, message);
 }
 void Logger::logWarning(const std::string &message)
 {
-    WriteLog("Warning", message);
+    if (IsEnabled(LogLevel::Warning))
+        WriteLog(LogLevel::Warning, message);
 }
 void Logger::logError(const std::string &message)
 {
-    WriteLog("Error", message);
+    if (IsEnabled(LogLevel::Error))
+        WriteLog(LogLevel::Error, message);
+}
+// Stress benchmark: `threads` writers each log `linesPerThread` records.
+static double BenchmarkLinesPerSecond(int threads, int linesPerThread)
+{
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([t, linesPerThread]()
+                             {
+            std::string message = "worker " + std::to_string(t) + " processed request";
+            for (int i = 0; i < linesPerThread; i++)
+            {
+                Logger::Get_instance().logInfo(message);
+            } });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    Logger::Get_instance().flush();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return threads * static_cast<double>(linesPerThread) / elapsed.count();
+}
+
+static void RunBenchmark()
+{
+    const int threads = 16;
+    const int linesPerThread = 20000;
+
+    auto report = [](const char *name, double linesPerSecond, double baseline)
+    {
+        std::cout << name << static_cast<long long>(linesPerSecond) << " lines/s ("
+                  << std::setprecision(3) << linesPerSecond / baseline << "x)" << std::endl;
+    };
+
+    double direct = BenchmarkLinesPerSecond(threads, linesPerThread);
+    report("direct        : ", direct, direct);
+
+    Logger::Get_instance().SetSink(LogSink::Mapped);
+    report("direct mapped : ", BenchmarkLinesPerSecond(threads, linesPerThread), direct);
+
+    Logger::Get_instance().SetSink(LogSink::Stream);
+    Logger::Get_instance().EnableStaging();
+    report("staged        : ", BenchmarkLinesPerSecond(threads, linesPerThread), direct);
+
+    Logger::Get_instance().SetSink(LogSink::Mapped);
+    report("staged mapped : ", BenchmarkLinesPerSecond(threads, linesPerThread), direct);
+
+    Logger::Get_instance().SetSink(LogSink::Stream);
+    Logger::Get_instance().SetFormat(LogFormat::Binary);
+    report("binary        : ", BenchmarkLinesPerSecond(threads, linesPerThread), direct);
 }
-void Logger::Cleanup()
+
+// Shutdown stress: writers keep logging into the async queue while the main
+// thread switches async mode off under them, as the destructor does at exit.
+// Every record must reach Application.log.
+static int RunAsyncShutdownStress()
 {
-    delete Logger_instance;
-    Logger_instance = nullptr;
+    const int threads = 8;
+    const int linesPerThread = 20000;
+    const int rounds = 5;
+    std::string tag = "shutdown-stress-" + std::to_string(::getpid());
+
+    for (int round = 0; round < rounds; round++)
+    {
+        Logger::Get_instance().EnableAsync(256, OverflowPolicy::Block);
+        std::atomic<int> logged(0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]()
+                                 {
+                std::string message = tag + " round " + std::to_string(round) + " worker " + std::to_string(t);
+                for (int i = 0; i < linesPerThread; i++)
+                {
+                    Logger::Get_instance().logInfo(message);
+                    logged.fetch_add(1, std::memory_order_relaxed);
+                } });
+        }
+        // Stop while the writers are in full swing.
+        while (logged.load(std::memory_order_relaxed) < threads * linesPerThread / 4)
+        {
+            std::this_thread::yield();
+        }
+        Logger::Get_instance().DisableAsync();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+    Logger::Get_instance().flush();
+
+    std::ifstream log("Application.log");
+    std::string line;
+    long found = 0;
+    while (std::getline(log, line))
+    {
+        if (line.find(tag) != std::string::npos)
+        {
+            found++;
+        }
+    }
+    long expected = static_cast<long>(threads) * linesPerThread * rounds;
+    std::cout << found << " of " << expected << " records written"
+              << (found == expected ? "" : " - RECORDS LOST") << std::endl;
+    return found == expected ? 0 : 1;
 }
 
 int main(int argc, const char **argv)
 {
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--bench")
+    {
+        RunBenchmark();
+        return 0;
+    }
+    if (mode == "--stress-async-shutdown")
+    {
+        return RunAsyncShutdownStress();
+    }
+    if (mode == "--async")
+    {
+        Logger::Get_instance().EnableAsync(1024, OverflowPolicy::DropOldest);
+    }
+    else if (mode == "--staged")
+    {
+        Logger::Get_instance().EnableStaging();
+    }
+    else if (mode == "--binary")
+    {
+        Logger::Get_instance().SetFormat(LogFormat::Binary);
+    }
+    else if (mode == "--mapped")
+    {
+        Logger::Get_instance().SetSink(LogSink::Mapped, 4096);
+    }
+    else if (mode == "--rotate")
+    {
+        RotationPolicy policy;
+        policy.maxBytes = 128;
+        policy.keepCount = 4;
+        Logger::Get_instance().SetRotation(policy);
+    }
+
     Logger::Get_instance().logError("this is an error message");
     Logger::Get_instance().logWarning("this is a warning message");
     Logger::Get_instance().logInfo("this is an info message");
 
+    LOG_INFO("processed {} requests in {} ms", 42, 3.5);
+    Logger::Get_instance().SetLevel(LogLevel::Warning);
+    LOG_INFO("this is not formatted or written: {}", "disabled");
+    LOG_WARNING("{} of {} retries left", 1, 3);
+
     return 0;
 }
@@ -1,4 +1,130 @@
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include "SingletonHolder.hpp"
+
+// Counter split into cache-line sized slots, one per thread (round robin when
+// there are more threads than slots), so concurrent updates do not bounce one
+// cache line between cores. Each slot only ever grows: increments and
+// decrements are counted separately, which lets Read() take a consistent
+// snapshot by collecting all slots twice until both passes agree.
+class ShardedCounter
+{
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<long> increments{0};
+        std::atomic<long> decrements{0};
+    };
+
+    // Sums of every slot at one pass.
+    struct Totals
+    {
+        long increments;
+        long decrements;
+
+        bool operator==(const Totals &other) const
+        {
+            return increments == other.increments && decrements == other.decrements;
+        }
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t slotCount;
+    std::atomic<std::size_t> nextSlot;
+    const std::uint64_t id; // never reused, unlike the address of a destroyed counter
+
+    static std::atomic<std::uint64_t> nextId;
+
+    Slot &LocalSlot();
+    Totals Collect() const;
+
+public:
+    explicit ShardedCounter(std::size_t shards = 0); // 0: one slot per hardware thread
+
+    void Increment();
+    void Decrement();
+    long Read() const;
+};
+
+std::atomic<std::uint64_t> ShardedCounter::nextId(1);
+
+ShardedCounter::ShardedCounter(std::size_t shards)
+    : nextSlot(0), id(nextId.fetch_add(1, std::memory_order_relaxed))
+{
+    slotCount = shards ? shards : std::max(1u, std::thread::hardware_concurrency());
+    slots.reset(new Slot[slotCount]);
+}
+
+// Each thread remembers its slot per counter, keyed by the counter's id, so
+// alternating between counters keeps the slots it was given.
+ShardedCounter::Slot &ShardedCounter::LocalSlot()
+{
+    struct Assigned
+    {
+        std::uint64_t counter;
+        Slot *slot;
+    };
+    static thread_local std::vector<Assigned> assigned;
+    for (const Assigned &entry : assigned)
+    {
+        if (entry.counter == id)
+        {
+            return *entry.slot;
+        }
+    }
+    Slot *slot = &slots[nextSlot.fetch_add(1, std::memory_order_relaxed) % slotCount];
+    assigned.push_back(Assigned{id, slot});
+    return *slot;
+}
+
+void ShardedCounter::Increment()
+{
+    LocalSlot().increments.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ShardedCounter::Decrement()
+{
+    LocalSlot().decrements.fetch_add(1, std::memory_order_relaxed);
+}
+
+ShardedCounter::Totals ShardedCounter::Collect() const
+{
+    Totals totals{0, 0};
+    for (std::size_t i = 0; i < slotCount; i++)
+    {
+        totals.increments += slots[i].increments.load(std::memory_order_acquire);
+        totals.decrements += slots[i].decrements.load(std::memory_order_acquire);
+    }
+    return totals;
+}
+
+// Slots only grow, so two passes with the same increment and the same
+// decrement sums mean every slot held its value at the moment between them
+// (equal net values are not enough: an increment and a decrement cancel).
+// Under constant updates this gives up after a few tries and returns the
+// last pass.
+long ShardedCounter::Read() const
+{
+    Totals previous = Collect();
+    for (int attempt = 0; attempt < 8; attempt++)
+    {
+        Totals current = Collect();
+        if (current == previous)
+        {
+            break;
+        }
+        previous = current;
+    }
+    return previous.increments - previous.decrements;
+}
 
 class Singleton
 {
@@ -6,20 +132,20 @@ private:
     Singleton();
     ~Singleton();
 
-    int counter;
-    static Singleton *singleton_instance;
-    static void Cleanup(); // Function to clean up the singleton instance.
+    ShardedCounter counter;
+    std::atomic<bool> quiet; // no console output on increment/decrement
+    friend class SingletonHolder<Singleton>; // Creates and destroys the single instance.
 
 public:
     static Singleton &Get_Instance(void);
     void display_Counter();
     void increment_counter();
     void decrement_counter();
+    long get_counter() const;
+    void set_quiet(bool enabled);
 };
 
-Singleton *Singleton::singleton_instance = nullptr;
-
-Singleton::Singleton() : counter(0)
+Singleton::Singleton() : quiet(false)
 {
     std::cout << __FUNCTION__ << std::endl;
 }
@@ -29,37 +155,137 @@ Singleton::~Singleton()
 }
 void Singleton::display_Counter()
 {
-    std::cout << "the counter value is " << counter << std::endl;
+    std::cout << "the counter value is " << counter.Read() << std::endl;
 }
 void Singleton::increment_counter()
 {
-    std::cout << __FUNCTION__ << std::endl;
-    this->counter++;
+    if (!quiet.load(std::memory_order_relaxed))
+        std::cout << __FUNCTION__ << std::endl;
+    this->counter.Increment();
 }
 void Singleton::decrement_counter()
 {
-    std::cout << __FUNCTION__ << std::endl;
-    this->counter--;
+    if (!quiet.load(std::memory_order_relaxed))
+        std::cout << __FUNCTION__ << std::endl;
+    this->counter.Decrement();
 }
-
-void Singleton::Cleanup()
+long Singleton::get_counter() const
 {
-    delete singleton_instance;
-    singleton_instance = nullptr;
+    return counter.Read();
 }
+void Singleton::set_quiet(bool enabled)
+{
+    quiet.store(enabled, std::memory_order_relaxed);
+}
+
+// Safe to call from many threads at first use; the instance is destroyed at exit.
 Singleton &Singleton::Get_Instance(void)
 {
-    if (!singleton_instance)
+    return SingletonHolder<Singleton>::Instance();
+}
+
+// Contention benchmark: every thread fetches the same singleton in a tight loop.
+struct BenchTarget
+{
+    int value = 1;
+};
+
+static BenchTarget *mutexInstance = nullptr;
+static std::mutex mutexInstanceLock;
+
+static BenchTarget &MutexGuardedInstance()
+{
+    std::lock_guard<std::mutex> lock(mutexInstanceLock);
+    if (!mutexInstance)
     {
-        singleton_instance = new Singleton();
-        std::atexit(Cleanup); // Register cleanup function to delete instance at program exit.
+        mutexInstance = new BenchTarget();
     }
+    return *mutexInstance;
+}
 
-    return *singleton_instance;
+static BenchTarget &FunctionLocalInstance()
+{
+    static BenchTarget instance;
+    return instance;
+}
+
+static BenchTarget &HolderInstance()
+{
+    return SingletonHolder<BenchTarget>::Instance();
+}
+
+template <typename Accessor>
+static double NanosecondsPerCall(Accessor accessor, int threads, long callsPerThread)
+{
+    std::vector<std::thread> workers;
+    std::vector<long> sums(threads);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            long sum = 0;
+            for (long i = 0; i < callsPerThread; i++)
+            {
+                sum += accessor().value;
+            }
+            sums[t] = sum; });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(callsPerThread); // wall time per call and thread
+}
+
+static void RunBenchmark()
+{
+    const long callsPerThread = 10000000;
+    int maxThreads = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+
+    std::cout << "threads  mutex(ns)  local-static(ns)  holder(ns)" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        std::cout << threads << "\t " << NanosecondsPerCall(MutexGuardedInstance, threads, callsPerThread)
+                  << "\t    " << NanosecondsPerCall(FunctionLocalInstance, threads, callsPerThread)
+                  << "\t\t  " << NanosecondsPerCall(HolderInstance, threads, callsPerThread) << std::endl;
+    }
+    delete mutexInstance;
+
+    // Counter scaling: one shared atomic against the sharded Singleton counter.
+    static std::atomic<long> sharedCounter(0);
+    Singleton::Get_Instance().set_quiet(true);
+    long start = Singleton::Get_Instance().get_counter();
+
+    std::cout << "threads  shared-atomic(ns)  sharded(ns)" << std::endl;
+    long expected = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        double shared = NanosecondsPerCall([]() -> BenchTarget &
+                                           {
+            static BenchTarget target;
+            sharedCounter.fetch_add(1, std::memory_order_relaxed);
+            return target; }, threads, callsPerThread);
+        double sharded = NanosecondsPerCall([]() -> BenchTarget &
+                                            {
+            static BenchTarget target;
+            Singleton::Get_Instance().increment_counter();
+            return target; }, threads, callsPerThread);
+        std::cout << threads << "\t " << shared << "\t\t    " << sharded << std::endl;
+        expected += threads * callsPerThread;
+    }
+    std::cout << "sharded total " << Singleton::Get_Instance().get_counter() - start
+              << " (expected " << expected << ")" << std::endl;
 }
 
 int main(int argc, const char **argv)
 {
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+    {
+        RunBenchmark();
+        return 0;
+    }
 
     Singleton::Get_Instance().display_Counter(); // 0
     Singleton::Get_Instance().increment_counter();
@@ -0,0 +1,128 @@
+#ifndef SINGLETON_HOLDER_HPP
+#define SINGLETON_HOLDER_HPP
+
+/*
+Reusable lazy singleton storage.
+
+SingletonHolder<T>::Instance() creates T on first use with double-checked
+locking: once the instance exists, every call is a single acquire load, and
+the first calls from several threads at once still create exactly one T.
+T keeps its constructor private and declares `friend class SingletonHolder<T>;`.
+
+Teardown is deterministic: instances are destroyed in reverse order of
+creation, either by SingletonRegistry::DestroyAll() or automatically at exit.
+A singleton that is created first (e.g. the Logger another singleton logs to
+from its constructor) is therefore destroyed last.
+
+    static EagerSingleton<Logger> eagerLogger; // optional: create before main()
+*/
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+class SingletonRegistry
+{
+private:
+    static std::mutex &Mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+    static std::vector<void (*)()> &Destroyers()
+    {
+        static std::vector<void (*)()> destroyers;
+        return destroyers;
+    }
+
+public:
+    // Called once per created instance, in creation order.
+    static void Register(void (*destroy)())
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+        std::vector<void (*)()> &destroyers = Destroyers();
+        // Hooked after the vector exists, so it is still alive when DestroyAll runs.
+        static bool hooked = (std::atexit(DestroyAll), true);
+        (void)hooked;
+        destroyers.push_back(destroy);
+    }
+
+    // Destroys every live singleton, newest first. A destructor that touches a
+    // singleton which is already gone recreates it, and that one is destroyed too.
+    static void DestroyAll()
+    {
+        for (;;)
+        {
+            void (*destroy)();
+            {
+                std::lock_guard<std::mutex> lock(Mutex());
+                if (Destroyers().empty())
+                {
+                    return;
+                }
+                destroy = Destroyers().back();
+                Destroyers().pop_back();
+            }
+            destroy(); // outside the lock, destructors may use other singletons
+        }
+    }
+};
+
+template <typename T>
+class SingletonHolder
+{
+private:
+    static inline std::atomic<T *> instance{nullptr};
+    static inline std::mutex creationMutex;
+
+    static T &Create()
+    {
+        std::lock_guard<std::mutex> lock(creationMutex);
+        T *created = instance.load(std::memory_order_relaxed);
+        if (!created)
+        {
+            created = new T();
+            instance.store(created, std::memory_order_release);
+            SingletonRegistry::Register(&Destroy);
+        }
+        return *created;
+    }
+
+    static void Destroy()
+    {
+        std::lock_guard<std::mutex> lock(creationMutex);
+        delete instance.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+public:
+    SingletonHolder() = delete;
+
+    static T &Instance()
+    {
+        T *existing = instance.load(std::memory_order_acquire);
+        if (existing)
+        {
+            return *existing; // fast path: one acquire load
+        }
+        return Create();
+    }
+
+    // The instance if it exists, without creating it.
+    static T *TryInstance()
+    {
+        return instance.load(std::memory_order_acquire);
+    }
+};
+
+// A namespace-scope `static EagerSingleton<T> name;` creates T during static
+// initialization, before main() and before any thread is started.
+template <typename T>
+struct EagerSingleton
+{
+    EagerSingleton()
+    {
+        SingletonHolder<T>::Instance();
+    }
+};
+
+#endif